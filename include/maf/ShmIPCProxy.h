@@ -0,0 +1,7 @@
+#pragma once
+
+#include <maf/messaging/client-server/ipc/shm/Proxy.h>
+
+namespace maf {
+namespace shmipc = maf::messaging::ipc::shm;
+} // namespace maf
@@ -3,11 +3,13 @@
 #include <maf/export/MafExport_global.h>
 #include <maf/logging/Logger.h>
 #include <maf/patterns/Patterns.h>
+#include <maf/threading/Task.h>
 #include <maf/utils/ExecutorIF.h>
 
 #include <future>
 
 #include "ProcessorDef.h"
+#include "ProcessorMetrics.h"
 
 namespace maf {
 namespace messaging {
@@ -31,14 +33,15 @@ class MAF_EXPORT MsgConnection {
 
 class Processor final : pattern::Unasignable,
                         public std::enable_shared_from_this<Processor> {
-  MAF_EXPORT Processor(ProcessorID id);
+  MAF_EXPORT Processor(ProcessorID id, QueueOptions queueOptions);
 
  public:
   using ThreadFunction = std::function<void()>;
   using Executor = std::shared_ptr<util::ExecutorIF>;
   using CompleteSignal = Upcoming<void>;
 
-  MAF_EXPORT static ProcessorInstance create(ProcessorID id = {});
+  MAF_EXPORT static ProcessorInstance create(ProcessorID id = {},
+                                             QueueOptions queueOptions = {});
   MAF_EXPORT static ProcessorInstance findProcessor(const ProcessorID &id);
   MAF_EXPORT const ProcessorID &id() const noexcept;
   MAF_EXPORT void run(ThreadFunction threadInit = {},
@@ -50,12 +53,20 @@ class Processor final : pattern::Unasignable,
   MAF_EXPORT void stop();
   MAF_EXPORT void reuse();
   MAF_EXPORT bool stopped() const;
+  // Max number of executions taken from queue at once, smaller batch lets
+  // stop requests and deadlines be checked more often
+  MAF_EXPORT void setMaxBatchSize(size_t size);
   MAF_EXPORT bool post(Message msg);
+  MAF_EXPORT bool post(Message msg, Priority priority);
+  MAF_EXPORT bool post(SharedMessage msg);
+  MAF_EXPORT bool post(SharedMessage msg, Priority priority);
   MAF_EXPORT CompleteSignal waitablePost(Message msg);
+  MAF_EXPORT CompleteSignal waitablePost(SharedMessage msg);
   MAF_EXPORT bool connected(const MessageID &mid) const;
-  MAF_EXPORT bool executeAsync(Execution exec);
-  MAF_EXPORT bool execute(Execution exec);
-  MAF_EXPORT CompleteSignal waitableExecute(Execution exec);
+  MAF_EXPORT bool executeAsync(threading::Task task);
+  MAF_EXPORT bool executeAsync(threading::Task task, Priority priority);
+  MAF_EXPORT bool execute(threading::Task task);
+  MAF_EXPORT CompleteSignal waitableExecute(threading::Task task);
   MAF_EXPORT Executor getExecutor();
   MAF_EXPORT Executor getAsyncExecutor();
   MAF_EXPORT Executor getBlockingExecutor();
@@ -67,6 +78,10 @@ class Processor final : pattern::Unasignable,
   connect(const MessageID &msgid, MessageProcessingCallback processMsgCallback);
   MAF_EXPORT void disconnect(const MessageID &msgid);
   MAF_EXPORT size_t pendingCout() const;
+  // Metrics cost a timestamp per execution, then they are off by default.
+  // Enabling them again starts from zero.
+  MAF_EXPORT void setMetricsEnabled(bool enabled);
+  MAF_EXPORT ProcessorMetrics metrics() const;
 
   template <class Msg>
   bool connected() const;
@@ -102,7 +117,8 @@ class Processor final : pattern::Unasignable,
   std::unique_ptr<struct ProcessorDataPrv> d_;
 };
 
-MAF_EXPORT ProcessorInstance makeProcessor(ProcessorID id = {});
+MAF_EXPORT ProcessorInstance makeProcessor(ProcessorID id = {},
+                                           QueueOptions queueOptions = {});
 
 namespace this_processor {
 using CompleteSignal = Processor::CompleteSignal;
@@ -113,10 +129,12 @@ MAF_EXPORT const ProcessorID &id();
 MAF_EXPORT bool stop();
 MAF_EXPORT bool stopped();
 MAF_EXPORT bool post(Message msg);
+MAF_EXPORT bool post(Message msg, Priority priority);
 MAF_EXPORT Processor::CompleteSignal waitablePost(Message msg);
-MAF_EXPORT bool executeAsync(Execution exec);
-MAF_EXPORT bool execute(Execution exec);
-MAF_EXPORT CompleteSignal waitableExecute(Execution exec);
+MAF_EXPORT bool executeAsync(threading::Task task);
+MAF_EXPORT bool executeAsync(threading::Task task, Priority priority);
+MAF_EXPORT bool execute(threading::Task task);
+MAF_EXPORT CompleteSignal waitableExecute(threading::Task task);
 MAF_EXPORT Executor getAsyncExecutor();
 MAF_EXPORT Executor getExecutor();
 MAF_EXPORT Executor getWaitableExecutor();
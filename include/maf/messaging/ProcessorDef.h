@@ -22,12 +22,60 @@ using MessageID = std::type_index;
 using MessageProcessingCallback = std::function<void(const Message&)>;
 using Execution = std::function<void()>;
 using ExecutionTimeout = std::chrono::microseconds;
-using ExecutionDeadline = std::chrono::system_clock::time_point;
+// Steady, so that wall clock adjustments don't affect waiting
+using ExecutionDeadline = std::chrono::steady_clock::time_point;
+// Lane of a Processor queue, pending urgent executions are served before
+// normal ones, normal ones before background ones
+enum class Priority : char { Urgent, Normal, Background };
+inline constexpr size_t PriorityCount = 3;
+
+// How a bounded Processor queue treats new executions when it is full
+enum class OverflowPolicy : char {
+  Block,       // Producer waits until processor makes room
+  Reject,      // Execution is refused, executeAsync/post return false
+  DropOldest,  // Oldest pending execution is dropped to make room
+  Conflate     // Posted message replaces the pending one of same type,
+               // anything else is refused when queue is full
+};
+
+struct QueueOptions {
+  // 0 means unbounded
+  size_t capacity = 0;
+  OverflowPolicy overflowPolicy = OverflowPolicy::Block;
+  // onHighWatermark is called once queue depth reaches highWatermark, then
+  // onLowWatermark once it falls back to lowWatermark, producers can use them
+  // to throttle. highWatermark 0 disables both.
+  size_t highWatermark = 0;
+  size_t lowWatermark = 0;
+  std::function<void()> onHighWatermark;
+  std::function<void()> onLowWatermark;
+  // 0 serves priorities strictly, otherwise a priority is served at most
+  // priorityWeight times in a row while a lower one is waiting, so that
+  // background work can't starve
+  size_t priorityWeight = 0;
+};
+
 template <class Msg>
 using SpecificMsgProcessingCallback = std::function<void(const Msg&)>;
 using EmptyMsgProcessingCallback = std::function<void()>;
 using threading::Upcoming;
 
+// Immutable message shared by its receivers: posting it to many processors
+// copies a reference, then every handler gets the same payload
+class SharedMessage {
+ public:
+  SharedMessage() = default;
+  explicit SharedMessage(Message msg)
+      : content_{std::make_shared<const Message>(std::move(msg))} {}
+
+  const Message& content() const { return *content_; }
+  const std::type_info& type() const { return content_->type(); }
+  bool valid() const { return content_ != nullptr; }
+
+ private:
+  std::shared_ptr<const Message> content_;
+};
+
 // -----------------------------------------------------------
 
 template <class Msg>
@@ -36,6 +84,8 @@ template <class Msg>
 MessageID msgid(Msg&& msg);
 template <class SpecificMsg, class... Args>
 Message makeMessage(Args&&... args);
+template <class SpecificMsg, class... Args>
+SharedMessage makeSharedMessage(Args&&... args);
 
 template <class Msg>
 MessageID msgid() {
@@ -52,5 +102,10 @@ Message makeMessage(Args&&... args) {
   return SpecificMsg{std::forward<Args>(args)...};
 }
 
+template <class SpecificMsg, class... Args>
+SharedMessage makeSharedMessage(Args&&... args) {
+  return SharedMessage{makeMessage<SpecificMsg>(std::forward<Args>(args)...)};
+}
+
 }  // namespace messaging
 }  // namespace maf
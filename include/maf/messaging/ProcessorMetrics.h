@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+#include "ProcessorDef.h"
+
+namespace maf {
+namespace messaging {
+
+// Durations counted in power of two buckets of microseconds: bucket 0 holds
+// durations under 1us, bucket i holds [2^(i-1), 2^i) us and the last one
+// everything longer
+struct DurationHistogram {
+  using Duration = std::chrono::microseconds;
+  static constexpr size_t BucketCount = 24;
+
+  std::array<uint64_t, BucketCount> buckets = {};
+  uint64_t count = 0;
+  Duration total{0};
+  Duration max{0};
+
+  static size_t bucketOf(Duration d) {
+    size_t bucket = 0;
+    for (auto us = d.count(); us > 0 && bucket + 1 < BucketCount; us >>= 1) {
+      ++bucket;
+    }
+    return bucket;
+  }
+
+  static Duration upperBoundOf(size_t bucket) {
+    return Duration{Duration::rep{1} << bucket};
+  }
+
+  Duration mean() const {
+    return count > 0 ? total / static_cast<Duration::rep>(count) : Duration{0};
+  }
+
+  // Upper bound of the bucket that holds given percentile, in [0, 1]
+  Duration percentile(double p) const {
+    auto rank = static_cast<uint64_t>(p * count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BucketCount; ++i) {
+      seen += buckets[i];
+      if (seen > rank || seen == count) {
+        return std::min(upperBoundOf(i), max);
+      }
+    }
+    return max;
+  }
+};
+
+struct ProcessorMetrics {
+  size_t queueDepth = 0;
+  size_t peakQueueDepth = 0;
+  // Executions taken from queue since metrics were enabled
+  uint64_t executions = 0;
+  double executionsPerSecond = 0;
+  // Time executions waited in queue before being dispatched
+  DurationHistogram queueLatency;
+  // Time spent in handlers of each message type
+  std::unordered_map<MessageID, DurationHistogram> handlerTimes;
+};
+
+}  // namespace messaging
+}  // namespace maf
@@ -17,10 +17,13 @@ struct ProcessorStatusUpdateMsg {
 };
 
 MAF_EXPORT bool post(const ProcessorID& messageprocessorID, Message msg);
+// Broadcast message is shared by its receivers, it is not copied for each
 MAF_EXPORT bool postToAll(Message msg);
+MAF_EXPORT bool postToAll(SharedMessage msg);
 MAF_EXPORT Processor::CompleteSignal send(const ProcessorID& messageprocessorID,
                                           Message msg);
 MAF_EXPORT Processor::CompleteSignal sendToAll(Message msg);
+MAF_EXPORT Processor::CompleteSignal sendToAll(SharedMessage msg);
 MAF_EXPORT ProcessorInstance findProcessor(const ProcessorID& id);
 
 template <class Msg, typename... Args>
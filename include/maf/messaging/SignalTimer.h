@@ -18,6 +18,10 @@ class SignalTimer {
     impl_.start(interval, [this] { timeoutSignal(); });
   }
 
+  void start(Milliseconds interval, Milliseconds slack) {
+    impl_.start(interval, slack, [this] { timeoutSignal(); });
+  }
+
   void restart() { impl_.restart(); }
 
   void stop() { impl_.stop(); }
@@ -5,10 +5,15 @@
 #include <maf/utils/ExecutorIF.h>
 
 #include <chrono>
+#include <memory>
 
 namespace maf {
 namespace messaging {
 
+// Timer that doesn't need a Processor: all SyncTimers of the process share
+// one service thread, start returns immediately. Callback is called on the
+// service thread, or posted to executor if there's one, then it must not
+// block for long.
 class SyncTimer : public pattern::Unasignable {
   using ExecutorIFPtr = std::shared_ptr<util::ExecutorIF>;
 
@@ -27,7 +32,7 @@ class SyncTimer : public pattern::Unasignable {
   MAF_EXPORT void setCyclic(bool cyclic = true);
 
  private:
-  struct SyncTimerDataPrv *d_;
+  std::shared_ptr<struct SyncTimerDataPrv> d_;
 };
 
 }  // namespace messaging
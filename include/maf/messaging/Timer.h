@@ -13,11 +13,14 @@
 namespace maf {
 namespace messaging {
 
+// Slack is how late a timer is allowed to fire. Timers of a thread whose
+// slack windows overlap are fired together in one wakeup.
 class Timer : public pattern::Unasignable {
   using ExecutorIFPtr = std::shared_ptr<util::ExecutorIF>;
 
  public:
   typedef std::function<void()> TimeOutCallback;
+  using Milliseconds = std::chrono::milliseconds;
   MAF_EXPORT Timer(bool cyclic = false);
   MAF_EXPORT ~Timer();
   MAF_EXPORT void start(long long milliseconds, TimeOutCallback callback);
@@ -29,6 +32,11 @@ class Timer : public pattern::Unasignable {
   MAF_EXPORT void start(std::chrono::milliseconds milliseconds,
                         TimeOutCallback callback,
                         const ProcessorInstance& comp);
+  MAF_EXPORT void start(Milliseconds interval, Milliseconds slack,
+                        TimeOutCallback callback);
+  MAF_EXPORT void start(Milliseconds interval, Milliseconds slack,
+                        TimeOutCallback callback,
+                        const ProcessorInstance& comp);
 
   MAF_EXPORT void restart();
   MAF_EXPORT void stop();
@@ -45,6 +53,13 @@ class Timer : public pattern::Unasignable {
   MAF_EXPORT static void timeoutAfter(std::chrono::milliseconds milliseconds,
                                       TimeOutCallback callback,
                                       const ProcessorInstance& comp);
+  MAF_EXPORT static void timeoutAfter(Milliseconds interval,
+                                      Milliseconds slack,
+                                      TimeOutCallback callback);
+  MAF_EXPORT static void timeoutAfter(Milliseconds interval,
+                                      Milliseconds slack,
+                                      TimeOutCallback callback,
+                                      const ProcessorInstance& comp);
 
  private:
   std::shared_ptr<struct TimerData> d_;
@@ -15,6 +15,17 @@ MAF_EXPORT void shutdownAllServers();
 MAF_EXPORT void shutdownAllClients();
 MAF_EXPORT void shutdownAll();
 
+// Number of threads decoding and handling messages coming from other
+// processes. Messages of same source and service are always handled in
+// order on one thread. Must be called before the first server or client is
+// created, returns false otherwise.
+MAF_EXPORT bool setIncomingMessageThreadCount(size_t count);
+
+// Number of threads each ipc server writes one broadcast to its clients
+// with, then a slow client doesn't delay the others. 0, the default, writes
+// on the broadcasting thread. Applies to servers created afterwards.
+MAF_EXPORT bool setBroadcastWriterThreadCount(size_t count);
+
 MAF_EXPORT std::shared_ptr<ServiceRequesterIF> getServiceRequester(
     const ConnectionType &conntype, const Address &serverAddr,
     const ServiceID &sid) noexcept;
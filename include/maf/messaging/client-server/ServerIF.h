@@ -5,6 +5,8 @@
 #include "CSStatus.h"
 #include "ServiceStatusObserverIF.h"
 
+#include <vector>
+
 namespace maf {
 namespace messaging {
 
@@ -17,6 +19,18 @@ class MAF_EXPORT ServerIF : public CSMessageReceiverIF,
   virtual ~ServerIF() = default;
   virtual ActionCallStatus sendMessageToClient(const CSMessagePtr &msg,
                                                const Address &addr) = 0;
+  // Sends same message to many clients. Returns status of each address in
+  // same order as addrs. Servers may override it to encode the message once
+  // and write it to clients in parallel.
+  virtual std::vector<ActionCallStatus> sendMessageToClients(
+      const CSMessagePtr &msg, const std::vector<Address> &addrs) {
+    std::vector<ActionCallStatus> results;
+    results.reserve(addrs.size());
+    for (const auto &addr : addrs) {
+      results.push_back(sendMessageToClient(msg, addr));
+    }
+    return results;
+  }
   virtual ServiceProviderIFPtr getServiceProvider(const ServiceID &sid) = 0;
   virtual bool hasServiceProvider(const ServiceID &sid) = 0;
   virtual bool init(const Address &serverAddr) = 0;
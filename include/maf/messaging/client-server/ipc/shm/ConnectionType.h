@@ -0,0 +1,13 @@
+#pragma once
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+inline constexpr auto connection_type = "shm.ipc.messaging.maf";
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <maf/messaging/client-server/BasicStub.h>
+#include <maf/messaging/client-server/ipc/local/ParamTrait.h>
+
+#include "ConnectionType.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+// Messages are serialized the same way as local ipc
+using ParamTrait = local::ParamTrait;
+using Stub = BasicStub<ParamTrait>;
+using StubPtr = std::shared_ptr<Stub>;
+using ExecutorIFPtr = Stub::ExecutorIFPtr;
+template <class Input>
+using Request = Stub::Request<Input>;
+
+inline std::shared_ptr<Stub> createStub(const Address &addr,
+                                        const ServiceID &sid,
+                                        Stub::ExecutorIFPtr executor = {}) {
+  return Stub::createStub(connection_type, addr, sid, std::move(executor));
+}
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <maf/patterns/Patterns.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace maf {
+namespace threading {
+
+// Read-mostly value, readers never lock.
+// A writer copies the current value, modifies the copy then publishes it,
+// the old value is deleted once every reader that could have seen it is
+// gone. Readers are counted per epoch, writers flip the epoch and wait for
+// readers of the previous one to leave, then a reader must not keep its
+// reference while updating the same value.
+template <class T>
+class CopyOnWrite : public pattern::Unasignable {
+ public:
+  class ReadRef : public pattern::Unasignable {
+   public:
+    ReadRef(ReadRef &&other) noexcept
+        : value_{other.value_}, readers_{other.readers_} {
+      other.readers_ = nullptr;
+    }
+    ~ReadRef() {
+      if (readers_) {
+        readers_->fetch_sub(1, std::memory_order_release);
+      }
+    }
+
+    const T *operator->() const { return value_; }
+    const T &operator*() const { return *value_; }
+
+   private:
+    friend class CopyOnWrite;
+    ReadRef(const T *value, std::atomic_size_t *readers)
+        : value_{value}, readers_{readers} {}
+
+    const T *value_;
+    std::atomic_size_t *readers_;
+  };
+
+  template <class... Args>
+  CopyOnWrite(Args &&...args)
+      : value_{new T(std::forward<Args>(args)...)} {}
+  ~CopyOnWrite() { delete value_.load(); }
+
+  ReadRef read() const {
+    while (true) {
+      auto epoch = epoch_.load(std::memory_order_seq_cst);
+      auto &readers = readers_[epoch & 1];
+      readers.fetch_add(1, std::memory_order_seq_cst);
+      if (epoch_.load(std::memory_order_seq_cst) == epoch) {
+        return ReadRef{value_.load(std::memory_order_acquire), &readers};
+      }
+      readers.fetch_sub(1, std::memory_order_release);
+    }
+  }
+
+  // Writers are serialized, modify is called with a copy of current value
+  template <class Modify>
+  void update(Modify &&modify) {
+    std::lock_guard lock(writerMutex_);
+    auto old = value_.load(std::memory_order_relaxed);
+    auto fresh = std::make_unique<T>(*old);
+    modify(*fresh);
+    value_.store(fresh.release(), std::memory_order_release);
+
+    auto epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+    auto &oldReaders = readers_[epoch & 1];
+    while (oldReaders.load(std::memory_order_seq_cst) != 0) {
+      std::this_thread::yield();
+    }
+    delete old;
+  }
+
+ private:
+  std::atomic<T *> value_;
+  mutable std::atomic_size_t readers_[2] = {};
+  std::atomic_size_t epoch_ = 0;
+  std::mutex writerMutex_;
+};
+
+}  // namespace threading
+}  // namespace maf
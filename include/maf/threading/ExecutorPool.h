@@ -0,0 +1,89 @@
+#pragma once
+
+#include <maf/utils/ExecutorIF.h>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Future.h"
+#include "Task.h"
+
+namespace maf {
+namespace threading {
+
+// Thread pool that takes callables instead of Runnable. Tasks belong to the
+// pool, they are destroyed once run or when the pool is shut down.
+class ExecutorPool {
+ public:
+  template <class Fn>
+  using ResultOf = std::invoke_result_t<std::decay_t<Fn> &>;
+
+  virtual ~ExecutorPool() = default;
+  // Returns false once the pool is shut down, task is dropped then
+  virtual bool enqueue(Task task) = 0;
+  // Enqueues all tasks with a single synchronization, or none of them once
+  // the pool is shut down
+  virtual bool enqueueBulk(std::vector<Task> tasks) = 0;
+  virtual unsigned int threadCount() const = 0;
+  // Pending tasks are dropped, running ones are waited for
+  virtual void shutdown() = 0;
+
+  // Future of a dropped task is broken, the one of a task that throws gets
+  // the exception
+  template <class Fn>
+  Future<ResultOf<Fn>> submit(Fn &&fn) {
+    Promise<ResultOf<Fn>> promise;
+    auto future = promise.getFuture();
+    enqueue(package(std::move(promise), std::forward<Fn>(fn)));
+    return future;
+  }
+
+  template <class Fn>
+  std::vector<Future<ResultOf<Fn>>> submitBulk(std::vector<Fn> fns) {
+    std::vector<Future<ResultOf<Fn>>> futures;
+    std::vector<Task> tasks;
+    futures.reserve(fns.size());
+    tasks.reserve(fns.size());
+    for (auto &fn : fns) {
+      Promise<ResultOf<Fn>> promise;
+      futures.push_back(promise.getFuture());
+      tasks.push_back(package(std::move(promise), std::move(fn)));
+    }
+    enqueueBulk(std::move(tasks));
+    return futures;
+  }
+
+ private:
+  template <class R, class Fn>
+  static Task package(Promise<R> promise, Fn &&fn) {
+    return [promise = std::move(promise),
+            fn = std::decay_t<Fn>(std::forward<Fn>(fn))]() mutable {
+      promise.setResultOf(fn);
+    };
+  }
+};
+
+using ExecutorPoolPtr = std::shared_ptr<ExecutorPool>;
+
+// Lets an ExecutorPool be the executor of stubs, proxies, timers... it keeps
+// the pool alive
+class ExecutorPoolAdapter : public util::ExecutorIF {
+ public:
+  explicit ExecutorPoolAdapter(ExecutorPoolPtr pool) : pool_{std::move(pool)} {}
+
+  bool execute(CallbackType callback) noexcept override {
+    return callback && pool_->enqueue(std::move(callback));
+  }
+
+ private:
+  ExecutorPoolPtr pool_;
+};
+
+inline util::ExecutorIFPtr executorOf(ExecutorPoolPtr pool) {
+  return std::make_shared<ExecutorPoolAdapter>(std::move(pool));
+}
+
+}  // namespace threading
+}  // namespace maf
@@ -0,0 +1,479 @@
+#pragma once
+
+#include <maf/utils/ExecutorIF.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include "Task.h"
+
+namespace maf {
+namespace threading {
+
+template <class T>
+class Promise;
+template <class T>
+class Future;
+
+namespace details {
+
+struct Unit {};
+
+template <class T>
+using StoredType = std::conditional_t<std::is_void_v<T>, Unit, T>;
+
+// What a continuation of Future<T> returns
+template <class T, class Fn>
+struct ContinuationResult {
+  using type = std::invoke_result_t<Fn, T>;
+};
+template <class Fn>
+struct ContinuationResult<void, Fn> {
+  using type = std::invoke_result_t<Fn>;
+};
+
+// Result of a promise and the continuation waiting for it. Whichever of
+// completing and attaching comes second runs the continuation, then neither
+// side locks. An empty result without exception means the promise was
+// broken.
+template <class T>
+class FutureState {
+ public:
+  using Result = std::optional<StoredType<T>>;
+
+  void complete(Result result, std::exception_ptr exception = nullptr) {
+    result_ = std::move(result);
+    exception_ = std::move(exception);
+    if (flags_.fetch_or(Ready, std::memory_order_acq_rel) & Attached) {
+      runContinuation();
+    }
+  }
+
+  // At most one continuation, it runs on the thread that completes the state
+  // or right away if the state is already completed
+  void onReady(Task continuation) {
+    continuation_ = std::move(continuation);
+    if (flags_.fetch_or(Attached, std::memory_order_acq_rel) & Ready) {
+      runContinuation();
+    }
+  }
+
+  bool ready() const { return flags_.load(std::memory_order_acquire) & Ready; }
+  Result &result() { return result_; }
+  const std::exception_ptr &exception() const { return exception_; }
+
+ private:
+  static constexpr unsigned Ready = 1;
+  static constexpr unsigned Attached = 2;
+
+  void runContinuation() {
+    auto continuation = std::move(continuation_);
+    continuation();
+  }
+
+  Result result_;
+  std::exception_ptr exception_;
+  Task continuation_;
+  std::atomic_uint flags_ = 0;
+};
+
+// Blocking waits attach a waiter as the continuation, then only futures that
+// are actually waited on pay for a mutex and a condition variable.
+// A continuation attached after a timed out wait is chained to the waiter.
+struct FutureWaiter {
+  std::mutex mutex;
+  std::condition_variable readyCondition;
+  bool ready = false;
+  Task next;
+
+  void notify() {
+    Task chained;
+    {
+      std::lock_guard lock(mutex);
+      ready = true;
+      chained = std::move(next);
+    }
+    readyCondition.notify_all();
+    if (chained) {
+      chained();
+    }
+  }
+
+  void chain(Task continuation) {
+    {
+      std::lock_guard lock(mutex);
+      if (!ready) {
+        next = std::move(continuation);
+        return;
+      }
+    }
+    continuation();
+  }
+};
+
+}  // namespace details
+
+// Write end of a Future. Destroying a promise that has no value yet breaks
+// it: waiters wake up and get() returns nothing, or throws
+// std::future_error for void.
+template <class T>
+class Promise {
+  using State = details::FutureState<T>;
+
+ public:
+  Promise() : state_{std::make_shared<State>()} {}
+  Promise(Promise &&) noexcept = default;
+  Promise &operator=(Promise &&other) noexcept {
+    if (this != &other) {
+      complete(std::nullopt);
+      state_ = std::move(other.state_);
+    }
+    return *this;
+  }
+  Promise(const Promise &) = delete;
+  Promise &operator=(const Promise &) = delete;
+  ~Promise() { complete(std::nullopt); }
+
+  // Only one future is given per promise
+  Future<T> getFuture() {
+    assert(state_ && !futureRetrieved_);
+    futureRetrieved_ = true;
+    return Future<T>{state_};
+  }
+
+  template <class... Value>
+  void setValue(Value &&...value) {
+    complete(details::StoredType<T>(std::forward<Value>(value)...));
+  }
+
+  void setException(std::exception_ptr exception) {
+    complete(std::nullopt, std::move(exception));
+  }
+
+  // Sets what fn returns, or the exception it throws
+  template <class Fn>
+  void setResultOf(Fn &&fn) {
+    typename State::Result result;
+    try {
+      if constexpr (std::is_void_v<T>) {
+        std::forward<Fn>(fn)();
+        result.emplace();
+      } else {
+        result.emplace(std::forward<Fn>(fn)());
+      }
+    } catch (...) {
+      setException(std::current_exception());
+      return;
+    }
+    complete(std::move(result));
+  }
+
+ private:
+  template <class>
+  friend class Future;
+
+  void complete(typename State::Result result,
+                std::exception_ptr exception = nullptr) {
+    if (auto state = std::move(state_)) {
+      state->complete(std::move(result), std::move(exception));
+    }
+  }
+
+  std::shared_ptr<State> state_;
+  bool futureRetrieved_ = false;
+};
+
+template <class T>
+struct WhenAnyResult;
+
+// Read end of a Promise, move only. Continuations attached by then() run on
+// the thread that sets the value, or on the given executor, nothing blocks
+// unless wait/get is called.
+template <class T>
+class Future {
+  using State = details::FutureState<T>;
+
+ public:
+  using ValueType = T;
+  // get() of a broken or invalid future returns an empty optional, or
+  // throws std::future_error for void
+  using Result = std::conditional_t<std::is_void_v<T>, void, std::optional<T>>;
+
+  Future() = default;
+  Future(Future &&) noexcept = default;
+  Future &operator=(Future &&) noexcept = default;
+  Future(const Future &) = delete;
+  Future &operator=(const Future &) = delete;
+
+  bool valid() const { return state_ != nullptr; }
+  bool ready() const { return state_ && state_->ready(); }
+
+  // Waiting on an invalid future throws std::future_error, as std::future
+  void wait() {
+    checkState();
+    if (!ready()) {
+      auto &w = waiter();
+      std::unique_lock lock(w.mutex);
+      w.readyCondition.wait(lock, [&w] { return w.ready; });
+    }
+  }
+
+  template <class Rep, class Period>
+  std::future_status waitFor(
+      const std::chrono::duration<Rep, Period> &timeout) {
+    return waitUntil(std::chrono::steady_clock::now() + timeout);
+  }
+
+  template <class Clock, class Duration>
+  std::future_status waitUntil(
+      const std::chrono::time_point<Clock, Duration> &deadline) {
+    checkState();
+    if (!ready()) {
+      auto &w = waiter();
+      std::unique_lock lock(w.mutex);
+      if (!w.readyCondition.wait_until(lock, deadline,
+                                       [&w] { return w.ready; })) {
+        return std::future_status::timeout;
+      }
+    }
+    return std::future_status::ready;
+  }
+
+  // Waits then takes the value, once. Rethrows the exception the promise
+  // was given.
+  Result get() {
+    if constexpr (std::is_void_v<T>) {
+      wait();
+      rethrowIfFailed();
+      if (!state_->result()) {
+        throw std::future_error{std::future_errc::broken_promise};
+      }
+    } else {
+      if (!valid()) {
+        return {};
+      }
+      wait();
+      rethrowIfFailed();
+      auto &result = state_->result();
+      return result ? Result{std::move(*result)} : Result{};
+    }
+  }
+
+  // fn gets the value, or nothing for Future<void>, and its result sets the
+  // returned future, or the exception it throws. fn is skipped if this
+  // future is broken or holds an exception, the returned one is then broken
+  // too or gets that exception. This future is invalid afterward.
+  template <class Fn>
+  auto then(Fn fn) {
+    return then(nullptr, std::move(fn));
+  }
+
+  // Same as then(fn), fn is executed by executor. If executor refuses it the
+  // returned future is broken.
+  template <class Fn>
+  auto then(util::ExecutorIFPtr executor, Fn fn) {
+    using Next = typename details::ContinuationResult<T, Fn>::type;
+    if (!valid()) {
+      return Future<Next>{};
+    }
+    Promise<Next> promise;
+    auto next = promise.getFuture();
+    onReady([state = state_, promise = std::move(promise), fn = std::move(fn),
+             executor = std::move(executor)]() mutable {
+      if (state->exception()) {
+        promise.setException(state->exception());
+        return;
+      }
+      if (!state->result()) {
+        return;
+      }
+      auto run = [state, promise = std::move(promise),
+                  fn = std::move(fn)]() mutable {
+        fulfill(promise, fn, *state->result());
+      };
+      if (!executor) {
+        run();
+      } else {
+        // ExecutorIF takes copyable callbacks only
+        executor->execute(
+            [run = std::make_shared<decltype(run)>(std::move(run))] {
+              (*run)();
+            });
+      }
+    });
+    release();
+    return next;
+  }
+
+ private:
+  template <class>
+  friend class Promise;
+  template <class U>
+  friend Future<std::vector<Future<U>>> whenAll(std::vector<Future<U>>);
+  template <class U>
+  friend Future<WhenAnyResult<U>> whenAny(std::vector<Future<U>>);
+
+  explicit Future(std::shared_ptr<State> state) : state_{std::move(state)} {}
+
+  template <class Next, class Fn>
+  static void fulfill(Promise<Next> &promise, Fn &fn,
+                      details::StoredType<T> &value) {
+    promise.setResultOf([&fn, &value]() -> Next {
+      if constexpr (std::is_void_v<T>) {
+        return fn();
+      } else {
+        return fn(std::move(value));
+      }
+    });
+  }
+
+  void checkState() const {
+    if (!valid()) {
+      throw std::future_error{std::future_errc::no_state};
+    }
+  }
+
+  void rethrowIfFailed() const {
+    if (auto &exception = state_->exception()) {
+      std::rethrow_exception(exception);
+    }
+  }
+
+  details::FutureWaiter &waiter() {
+    if (!waiter_) {
+      waiter_ = std::make_shared<details::FutureWaiter>();
+      state_->onReady([waiter = waiter_] { waiter->notify(); });
+    }
+    return *waiter_;
+  }
+
+  void onReady(Task continuation) {
+    if (waiter_) {
+      waiter_->chain(std::move(continuation));
+    } else {
+      state_->onReady(std::move(continuation));
+    }
+  }
+
+  // Moves the result to a fresh future once it is ready, then calls
+  // onRelayed. The fresh future has no continuation attached yet.
+  template <class OnRelayed>
+  Future relay(OnRelayed onRelayed) {
+    Promise<T> promise;
+    auto relayed = promise.getFuture();
+    onReady([state = state_, promise = std::move(promise),
+             onRelayed = std::move(onRelayed)]() mutable {
+      promise.complete(std::move(state->result()), state->exception());
+      onRelayed();
+    });
+    release();
+    return relayed;
+  }
+
+  void release() {
+    state_.reset();
+    waiter_.reset();
+  }
+
+  std::shared_ptr<State> state_;
+  std::shared_ptr<details::FutureWaiter> waiter_;
+};
+
+template <class T>
+struct WhenAnyResult {
+  // Position of the first ready future, or SIZE_MAX if there was none
+  size_t index = SIZE_MAX;
+  std::vector<Future<T>> futures;
+};
+
+// Ready once every future is ready, its value holds them
+template <class T>
+Future<std::vector<Future<T>>> whenAll(std::vector<Future<T>> futures) {
+  struct Context {
+    std::vector<Future<T>> futures;
+    // One more for the setup, so that the result is not set while futures
+    // are still being relayed
+    std::atomic_size_t pending;
+    Promise<std::vector<Future<T>>> promise;
+
+    void arrive() {
+      if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        promise.setValue(std::move(futures));
+      }
+    }
+  };
+
+  auto context = std::make_shared<Context>();
+  auto all = context->promise.getFuture();
+  context->futures.resize(futures.size());
+  context->pending = futures.size() + 1;
+  for (size_t i = 0; i < futures.size(); ++i) {
+    if (futures[i].valid()) {
+      context->futures[i] =
+          futures[i].relay([context] { context->arrive(); });
+    } else {
+      context->arrive();
+    }
+  }
+  context->arrive();
+  return all;
+}
+
+// Ready once any of the futures is ready, its value holds them and the
+// index of that one
+template <class T>
+Future<WhenAnyResult<T>> whenAny(std::vector<Future<T>> futures) {
+  struct Context {
+    WhenAnyResult<T> result;
+    std::atomic_size_t first = SIZE_MAX;
+    // The first ready future and the setup both arrive, the later one sets
+    // the result
+    std::atomic_int arrivals = 2;
+    Promise<WhenAnyResult<T>> promise;
+
+    void arrive() {
+      if (arrivals.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        result.index = first.load(std::memory_order_relaxed);
+        promise.setValue(std::move(result));
+      }
+    }
+
+    void readyAt(size_t index) {
+      auto expected = SIZE_MAX;
+      if (first.compare_exchange_strong(expected, index,
+                                        std::memory_order_acq_rel)) {
+        arrive();
+      }
+    }
+  };
+
+  auto context = std::make_shared<Context>();
+  auto any = context->promise.getFuture();
+  context->result.futures.resize(futures.size());
+  bool anyValid = false;
+  for (size_t i = 0; i < futures.size(); ++i) {
+    if (futures[i].valid()) {
+      anyValid = true;
+      context->result.futures[i] =
+          futures[i].relay([context, i] { context->readyAt(i); });
+    }
+  }
+  if (!anyValid) {
+    // Nothing will ever be ready
+    context->arrive();
+  }
+  context->arrive();
+  return any;
+}
+
+}  // namespace threading
+}  // namespace maf
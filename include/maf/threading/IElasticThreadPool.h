@@ -0,0 +1,33 @@
+#pragma once
+
+#include "IThreadPool.h"
+#include <chrono>
+
+namespace maf {
+namespace threading {
+
+struct ElasticPoolOptions {
+  // Threads kept even when idle
+  unsigned int minThreadCount = 0;
+  // 0 means std::thread::hardware_concurrency()
+  unsigned int maxThreadCount = 0;
+  // A thread is spawned once the oldest queued task has waited this long
+  // and no thread is idle. Above 0 the pool has a monitor thread to check it.
+  std::chrono::milliseconds spawnLatency{0};
+  // Threads above minThreadCount exit after being idle this long
+  std::chrono::milliseconds idleTimeout{10000};
+};
+
+// Pool that grows when queued tasks wait too long and shrinks when its
+// threads are idle, activeThreadCount() is the current thread count
+class IElasticThreadPool : public IThreadPool {
+public:
+  // Max thread count is raised to it if smaller, setMaxThreadCount lowers
+  // min thread count the same way
+  virtual void setMinThreadCount(unsigned int nThreadCount) = 0;
+  virtual unsigned int minThreadCount() = 0;
+  virtual unsigned int maxThreadCount() = 0;
+};
+
+} // namespace threading
+} // namespace maf
@@ -0,0 +1,463 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+
+namespace maf {
+namespace threading {
+
+// Multi-producer/single-consumer queue with LaneCount priority lanes, lane 0
+// is served first.
+// Producers never take a lock: a push claims a slot of the current segment
+// of its lane with one CAS and constructs the value in place. Segments are
+// linked when full and recycled by the consumer, then a busy queue doesn't
+// allocate. Consumer side is serialized by a mutex that is uncontended in
+// normal use, so close and clear can still be called from any thread. A
+// consumer finding the queue empty parks, and producers pay for waking it up
+// only when it is really parked.
+// Lanes are served with strict priority by default, setLaneWeight(n) lets a
+// lane be served at most n times in a row while a lower one is waiting. It
+// then yields one turn to the highest lower lane that still has turns left,
+// or to the lowest waiting one, then every waiting lane keeps progressing:
+// with all lanes busy, lane k gets about one turn of (n + 1)^k.
+template <typename T, size_t LaneCount = 1, size_t SegmentCapacity = 63>
+class PriorityMPSCQueue {
+  static_assert(LaneCount > 0, "Queue must have at least 1 lane");
+  static_assert(SegmentCapacity > 1, "Segment must have at least 2 slots");
+  static_assert(std::is_nothrow_move_constructible_v<T>,
+                "Value must be moved into its slot without throwing");
+
+ public:
+  using value_type = T;
+
+  PriorityMPSCQueue() = default;
+  PriorityMPSCQueue(const PriorityMPSCQueue &) = delete;
+  PriorityMPSCQueue &operator=(const PriorityMPSCQueue &) = delete;
+  ~PriorityMPSCQueue() {
+    close();
+    clear();
+    for (auto &lane : lanes_) {
+      delete lane.headSegment;
+    }
+    delete spareSegment_.load();
+  }
+
+  bool push(value_type &&value, size_t lane = 0) {
+    return pushIf(lanes_[lane], value, [](size_t) { return true; });
+  }
+
+  // Pushes only if there are less than capacity values in queue, value is
+  // left untouched otherwise
+  bool tryPush(value_type &&value, size_t capacity, size_t lane = 0) {
+    auto &target = lanes_[lane];
+    return pushIf(target, value, [this, &target, capacity](size_t tail) {
+      auto head = target.headIndex.load(std::memory_order_seq_cst);
+      auto otherLanes = size() - sizeOf(target);
+      return countOf(tail) - countOf(head) + otherLanes < capacity;
+    });
+  }
+
+  // Waits for the consumer to make room if queue holds capacity values
+  bool pushWhenRoom(value_type &&value, size_t capacity, size_t lane = 0) {
+    while (!tryPush(std::move(value), capacity, lane)) {
+      if (isClosed()) {
+        return false;
+      }
+      std::unique_lock lock(roomMutex_);
+      roomWaiters_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      roomCondition_.wait(
+          lock, [this, capacity] { return size() < capacity || isClosed(); });
+      roomWaiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return true;
+  }
+
+  // Lets a producer drop the oldest value of the lowest non empty lane to make
+  // room for its own
+  bool dropOldest() {
+    std::lock_guard lock(consumerMutex_);
+    for (auto lane = std::rbegin(lanes_); lane != std::rend(lanes_); ++lane) {
+      if (consumeOne(*lane, [](value_type &&) {})) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool push(const value_type &value, size_t lane = 0) {
+    return push(value_type{value}, lane);
+  }
+
+  // 0 means strict priority
+  void setLaneWeight(size_t weight) {
+    std::lock_guard lock(consumerMutex_);
+    laneWeight_ = weight;
+  }
+
+  bool tryPop(value_type &value) {
+    std::unique_lock lock(consumerMutex_);
+    if (!isClosed() && assignTo(value)()) {
+      lock.unlock();
+      notifyRoom();
+      return true;
+    }
+    return false;
+  }
+
+  bool wait(value_type &value) {
+    return waitWith(assignTo(value), [this] { return park(NoDeadline{}); });
+  }
+
+  template <class TimePoint>
+  bool waitUntil(value_type &value, const TimePoint &absTime) {
+    return waitWith(assignTo(value),
+                    [this, &absTime] { return park(absTime); });
+  }
+
+  template <class Duration>
+  bool waitFor(value_type &value, const Duration &interval) {
+    return waitUntil(value, std::chrono::steady_clock::now() + interval);
+  }
+
+  // Moves up to maxCount values to the back of out with one consumer lock,
+  // waits if there's none
+  template <class Container>
+  bool waitBatch(Container &out, size_t maxCount) {
+    return waitWith(
+        [this, &out, maxCount] { return consumeMany(out, maxCount) > 0; },
+        [this] { return park(NoDeadline{}); });
+  }
+
+  template <class Container, class TimePoint>
+  bool waitBatchUntil(Container &out, size_t maxCount,
+                      const TimePoint &absTime) {
+    return waitWith(
+        [this, &out, maxCount] { return consumeMany(out, maxCount) > 0; },
+        [this, &absTime] { return park(absTime); });
+  }
+
+  void reOpen() { closed_.store(false, std::memory_order_release); }
+
+  void close() {
+    if (!closed_.exchange(true, std::memory_order_acq_rel)) {
+      {
+        std::lock_guard lock(parkMutex_);
+        parked_.store(false, std::memory_order_relaxed);
+      }
+      parkCondition_.notify_all();
+      {
+        std::lock_guard lock(roomMutex_);
+      }
+      roomCondition_.notify_all();
+    }
+  }
+
+  bool isClosed() const { return closed_.load(std::memory_order_acquire); }
+
+  void clear() {
+    {
+      std::lock_guard lock(consumerMutex_);
+      for (auto &lane : lanes_) {
+        while (consumeOne(lane, [](value_type &&) {})) {
+        }
+      }
+    }
+    notifyRoom();
+  }
+
+  // Number of claimed slots, including the ones being written by producers
+  size_t size() const {
+    size_t total = 0;
+    for (auto &lane : lanes_) {
+      total += sizeOf(lane);
+    }
+    return total;
+  }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  struct NoDeadline {};
+
+  struct Slot {
+    std::atomic_bool ready = false;
+    std::aligned_storage_t<sizeof(value_type), alignof(value_type)> storage;
+
+    value_type &value() {
+      return *std::launder(reinterpret_cast<value_type *>(&storage));
+    }
+  };
+
+  struct Segment {
+    std::atomic<Segment *> next = nullptr;
+    Slot slots[SegmentCapacity];
+  };
+
+  struct Lane {
+    Lane() : tailSegment{new Segment}, headSegment{tailSegment.load()} {}
+
+    alignas(64) std::atomic_size_t tailIndex = 0;
+    std::atomic<Segment *> tailSegment;
+
+    // Consumer side
+    alignas(64) Segment *headSegment;
+    std::atomic_size_t headIndex = 0;
+    size_t servedInRow = 0;
+  };
+
+  // Each segment takes one more index than its slots, that index marks the
+  // segment is being switched
+  static constexpr size_t Lap = SegmentCapacity + 1;
+
+  static size_t countOf(size_t index) {
+    return index / Lap * SegmentCapacity + index % Lap;
+  }
+
+  Segment *takeSegment() {
+    if (auto segment = spareSegment_.exchange(nullptr)) {
+      return segment;
+    }
+    return new Segment;
+  }
+
+  void giveBackSegment(Segment *segment) {
+    Segment *noSpare = nullptr;
+    if (!spareSegment_.compare_exchange_strong(noSpare, segment)) {
+      delete segment;
+    }
+  }
+
+  static size_t sizeOf(const Lane &lane) {
+    auto head = lane.headIndex.load(std::memory_order_acquire);
+    auto tail = lane.tailIndex.load(std::memory_order_acquire);
+    return countOf(tail) - countOf(head);
+  }
+
+  // Must be called with consumerMutex_ locked
+  static bool hasReady(const Lane &lane) {
+    auto offset = lane.headIndex.load(std::memory_order_relaxed) % Lap;
+    return lane.headSegment->slots[offset].ready.load(
+        std::memory_order_acquire);
+  }
+
+  // Must be called with consumerMutex_ locked
+  Lane *nextLane() {
+    Lane *waiting[LaneCount];
+    size_t waitingCount = 0;
+    for (auto &lane : lanes_) {
+      if (hasReady(lane)) {
+        waiting[waitingCount++] = &lane;
+      } else {
+        lane.servedInRow = 0;
+      }
+    }
+    if (waitingCount == 0) {
+      return nullptr;
+    }
+    size_t next = 0;
+    if (laneWeight_ != 0) {
+      // Lowest waiting lane has no one to yield to
+      while (next + 1 < waitingCount &&
+             waiting[next]->servedInRow >= laneWeight_) {
+        ++next;
+      }
+    }
+    // Lanes skipped over have yielded their turn
+    for (size_t i = 0; i < next; ++i) {
+      waiting[i]->servedInRow = 0;
+    }
+    ++waiting[next]->servedInRow;
+    return waiting[next];
+  }
+
+  // Must be called with consumerMutex_ locked
+  template <class Consume>
+  bool consumeNext(Consume &&consume) {
+    auto lane = nextLane();
+    return lane && consumeOne(*lane, std::forward<Consume>(consume));
+  }
+
+  // Must be called with consumerMutex_ locked
+  template <class Consume>
+  bool consumeOne(Lane &lane, Consume &&consume) {
+    auto head = lane.headIndex.load(std::memory_order_relaxed);
+    auto offset = head % Lap;
+    auto &slot = lane.headSegment->slots[offset];
+    if (!slot.ready.load(std::memory_order_acquire)) {
+      return false;
+    }
+    consume(std::move(slot.value()));
+    slot.value().~value_type();
+    slot.ready.store(false, std::memory_order_relaxed);
+
+    if (offset + 1 == SegmentCapacity) {
+      auto next = lane.headSegment->next.load(std::memory_order_acquire);
+      lane.headSegment->next.store(nullptr, std::memory_order_relaxed);
+      giveBackSegment(lane.headSegment);
+      lane.headSegment = next;
+      lane.headIndex.store(head + 2, std::memory_order_release);
+    } else {
+      lane.headIndex.store(head + 1, std::memory_order_release);
+    }
+    return true;
+  }
+
+  template <class Admit>
+  bool pushIf(Lane &lane, value_type &value, Admit &&admit) {
+    if (isClosed()) {
+      return false;
+    }
+    Segment *spare = nullptr;
+    while (true) {
+      auto tail = lane.tailIndex.load(std::memory_order_acquire);
+      auto offset = tail % Lap;
+      if (offset == SegmentCapacity) {
+        // Another producer is linking the next segment
+        std::this_thread::yield();
+        continue;
+      }
+      if (!admit(tail)) {
+        if (spare) {
+          giveBackSegment(spare);
+        }
+        return false;
+      }
+      auto isLastSlot = offset + 1 == SegmentCapacity;
+      if (isLastSlot && !spare) {
+        spare = takeSegment();
+      }
+      auto segment = lane.tailSegment.load(std::memory_order_acquire);
+      if (lane.tailIndex.compare_exchange_weak(tail, tail + 1,
+                                               std::memory_order_seq_cst,
+                                               std::memory_order_relaxed)) {
+        if (isLastSlot) {
+          lane.tailSegment.store(spare, std::memory_order_release);
+          lane.tailIndex.store(tail + 2, std::memory_order_release);
+          segment->next.store(spare, std::memory_order_release);
+          spare = nullptr;
+        }
+        auto &slot = segment->slots[offset];
+        new (&slot.storage) value_type(std::move(value));
+        slot.ready.store(true, std::memory_order_release);
+        if (spare) {
+          giveBackSegment(spare);
+        }
+        unparkConsumer();
+        return true;
+      }
+    }
+  }
+
+  auto assignTo(value_type &value) {
+    return [this, &value] {
+      return consumeNext([&value](value_type &&v) { value = std::move(v); });
+    };
+  }
+
+  // Must be called with consumerMutex_ locked
+  template <class Container>
+  size_t consumeMany(Container &out, size_t maxCount) {
+    size_t count = 0;
+    while (count < maxCount &&
+           consumeNext([&out](value_type &&v) { out.push_back(std::move(v)); })) {
+      ++count;
+    }
+    return count;
+  }
+
+  template <class Take, class Park>
+  bool waitWith(Take &&take, Park &&park) {
+    auto taken = false;
+    while (!taken) {
+      {
+        std::lock_guard lock(consumerMutex_);
+        if (isClosed()) {
+          return false;
+        }
+        taken = take();
+      }
+      if (!taken && !park()) {
+        std::lock_guard lock(consumerMutex_);
+        taken = !isClosed() && take();
+        break;
+      }
+    }
+    if (taken) {
+      notifyRoom();
+    }
+    return taken;
+  }
+
+  void notifyRoom() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (roomWaiters_.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard lock(roomMutex_);
+      roomCondition_.notify_all();
+    }
+  }
+
+  // Returns false if deadline is reached before anything is pushed
+  template <class Deadline>
+  bool park(const Deadline &deadline) {
+    std::unique_lock lock(parkMutex_);
+    parked_.store(true, std::memory_order_seq_cst);
+    auto pushed = [](const Lane &lane) {
+      return countOf(lane.tailIndex.load(std::memory_order_seq_cst)) !=
+             countOf(lane.headIndex.load(std::memory_order_relaxed));
+    };
+    if (std::any_of(std::begin(lanes_), std::end(lanes_), pushed) ||
+        isClosed()) {
+      parked_.store(false, std::memory_order_relaxed);
+      return true;
+    }
+
+    auto unparked = [this] {
+      return !parked_.load(std::memory_order_relaxed) || isClosed();
+    };
+    auto woken = true;
+    if constexpr (std::is_same_v<Deadline, NoDeadline>) {
+      parkCondition_.wait(lock, unparked);
+    } else {
+      woken = parkCondition_.wait_until(lock, deadline, unparked);
+    }
+    parked_.store(false, std::memory_order_relaxed);
+    return woken;
+  }
+
+  void unparkConsumer() {
+    if (parked_.load(std::memory_order_seq_cst) &&
+        parked_.exchange(false, std::memory_order_acq_rel)) {
+      std::lock_guard lock(parkMutex_);
+      parkCondition_.notify_one();
+    }
+  }
+
+  Lane lanes_[LaneCount];
+  std::atomic<Segment *> spareSegment_ = nullptr;
+
+  alignas(64) std::mutex consumerMutex_;
+  size_t laneWeight_ = 0;
+
+  alignas(64) std::atomic_bool parked_ = false;
+  std::atomic_bool closed_ = false;
+  std::mutex parkMutex_;
+  std::condition_variable parkCondition_;
+
+  std::atomic_size_t roomWaiters_ = 0;
+  std::mutex roomMutex_;
+  std::condition_variable roomCondition_;
+};
+
+template <typename T, size_t SegmentCapacity = 63>
+using MPSCQueue = PriorityMPSCQueue<T, 1, SegmentCapacity>;
+
+}  // namespace threading
+}  // namespace maf
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace maf {
+namespace threading {
+
+// Move-only replacement of std::function<void()> for one shot executions.
+// Callables up to InlineCapacity bytes, that can be moved without throwing,
+// are stored inside the task itself, bigger ones are moved to heap.
+template <size_t InlineCapacity>
+class BasicTask {
+ public:
+  template <class Fn>
+  static constexpr bool fitsInline() {
+    return sizeof(Fn) <= InlineCapacity &&
+           alignof(Fn) <= alignof(std::max_align_t) &&
+           std::is_nothrow_move_constructible_v<Fn>;
+  }
+
+  BasicTask() noexcept = default;
+  BasicTask(std::nullptr_t) noexcept {}
+
+  template <class Callable, class Fn = std::decay_t<Callable>,
+            std::enable_if_t<!std::is_same_v<Fn, BasicTask> &&
+                                 std::is_invocable_v<Fn &>,
+                             bool> = true>
+  BasicTask(Callable &&f) {
+    if constexpr (std::is_constructible_v<bool, const Fn &>) {
+      // Empty std::function or null function pointer
+      if (!static_cast<bool>(f)) {
+        return;
+      }
+    }
+    if constexpr (fitsInline<Fn>()) {
+      new (&storage_) Fn(std::forward<Callable>(f));
+      ops_ = &InlineOps<Fn>::table;
+    } else {
+      new (&storage_) Fn *(new Fn(std::forward<Callable>(f)));
+      ops_ = &HeapOps<Fn>::table;
+    }
+  }
+
+  BasicTask(BasicTask &&other) noexcept { takeFrom(other); }
+
+  BasicTask &operator=(BasicTask &&other) noexcept {
+    if (this != &other) {
+      reset();
+      takeFrom(other);
+    }
+    return *this;
+  }
+
+  BasicTask &operator=(std::nullptr_t) noexcept {
+    reset();
+    return *this;
+  }
+
+  BasicTask(const BasicTask &) = delete;
+  BasicTask &operator=(const BasicTask &) = delete;
+
+  ~BasicTask() { reset(); }
+
+  explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+  void operator()() {
+    if (!ops_) {
+      throw std::bad_function_call{};
+    }
+    ops_->invoke(&storage_);
+  }
+
+ private:
+  struct Ops {
+    void (*invoke)(void *);
+    void (*move)(void *from, void *to) noexcept;
+    void (*destroy)(void *) noexcept;
+  };
+
+  template <class Fn>
+  struct InlineOps {
+    static Fn *get(void *s) { return std::launder(static_cast<Fn *>(s)); }
+    static void invoke(void *s) { (*get(s))(); }
+    static void move(void *from, void *to) noexcept {
+      new (to) Fn(std::move(*get(from)));
+      get(from)->~Fn();
+    }
+    static void destroy(void *s) noexcept { get(s)->~Fn(); }
+    static constexpr Ops table{&invoke, &move, &destroy};
+  };
+
+  template <class Fn>
+  struct HeapOps {
+    static Fn *&get(void *s) { return *std::launder(static_cast<Fn **>(s)); }
+    static void invoke(void *s) { (*get(s))(); }
+    static void move(void *from, void *to) noexcept {
+      new (to) Fn *(get(from));
+    }
+    static void destroy(void *s) noexcept { delete get(s); }
+    static constexpr Ops table{&invoke, &move, &destroy};
+  };
+
+  void takeFrom(BasicTask &other) noexcept {
+    if (other.ops_) {
+      other.ops_->move(&other.storage_, &storage_);
+      ops_ = std::exchange(other.ops_, nullptr);
+    }
+  }
+
+  void reset() noexcept {
+    if (ops_) {
+      std::exchange(ops_, nullptr)->destroy(&storage_);
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[InlineCapacity];
+  const Ops *ops_ = nullptr;
+};
+
+// 128 bytes in total, enough for the captures of almost every execution
+using Task = BasicTask<112>;
+
+}  // namespace threading
+}  // namespace maf
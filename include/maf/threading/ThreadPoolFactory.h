@@ -1,5 +1,7 @@
 #pragma once
 
+#include "ExecutorPool.h"
+#include "IElasticThreadPool.h"
 #include "IThreadPool.h"
 #include <maf/export/MafExport_global.h>
 #include <memory>
@@ -7,12 +9,22 @@
 namespace maf {
 namespace threading {
 
-enum PoolType { DynamicCount, StableCount, Priority };
+// Pools of type WorkStealing are also util::ExecutorIF, get it by
+// std::dynamic_pointer_cast<util::ExecutorIF>
+enum PoolType { DynamicCount, StableCount, Priority, WorkStealing };
 
 class ThreadPoolFactory {
 public:
   MAF_EXPORT static std::shared_ptr<IThreadPool>
   createPool(PoolType type, unsigned int poolSize = 0);
+  // Pool of type DynamicCount with more control over its growth, createPool
+  // gives one with default options and poolSize as max thread count
+  MAF_EXPORT static std::shared_ptr<IElasticThreadPool>
+  createElasticPool(const ElasticPoolOptions &options = {});
+  // Work stealing pool of poolSize threads, or one per core if 0. Use
+  // executorOf(pool) to give it as a util::ExecutorIF.
+  MAF_EXPORT static ExecutorPoolPtr
+  createExecutorPool(unsigned int poolSize = 0);
 };
 } // namespace threading
 } // namespace maf
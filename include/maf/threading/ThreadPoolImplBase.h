@@ -1,8 +1,8 @@
 #pragma once
 
 #include <atomic>
+#include <deque>
 #include <functional>
-#include <list>
 #include <maf/logging/Logger.h>
 #include <maf/threading/IThreadPool.h>
 #include <maf/threading/ThreadJoiner.h>
@@ -14,6 +14,41 @@ namespace maf {
 
 namespace threading {
 
+// Task being run by one pool thread, without a lock. Only the shutdown of
+// the pool uses it from another thread: it marks the slot while stopping the
+// task, then the owner waits for the mark to be gone before it is done with
+// the task.
+template <class Task> struct alignas(64) RunningSlot {
+  std::atomic<Task *> task = nullptr;
+
+  Task *stoppingMark() { return reinterpret_cast<Task *>(this); }
+
+  void enter(Task &running) {
+    task.store(&running, std::memory_order_release);
+  }
+
+  void leave(Task &running) {
+    auto expected = &running;
+    while (!task.compare_exchange_weak(expected, nullptr,
+                                       std::memory_order_acq_rel)) {
+      if (expected == stoppingMark()) {
+        std::this_thread::yield();
+      }
+      expected = &running;
+    }
+  }
+
+  template <class Stop> void stop(Stop &&fStop) {
+    auto running = task.load(std::memory_order_acquire);
+    if (running && running != stoppingMark() &&
+        task.compare_exchange_strong(running, stoppingMark(),
+                                     std::memory_order_acq_rel)) {
+      fStop(*running);
+      task.store(running, std::memory_order_release);
+    }
+  }
+};
+
 /*! \brief The base class used for implement the variants of threadpool
  * class ThreadPoolImplBase
  *
@@ -35,12 +70,16 @@ public:
 
   ~ThreadPoolImplBase() { shutdown(); }
 
+  // Thread safe, no thread is launched once the pool is shut down
   void tryLaunchNewThread() {
-    if (_pool.size() < _maxThreadCount) {
+    std::lock_guard<std::mutex> lock(_poolMutex);
+    if (!_stopped && _pool.size() < _maxThreadCount) {
+      auto &slot = _runningSlots.emplace_back();
       try {
         _pool.emplace_back(
-            std::thread{&ThreadPoolImplBase::coptRunPendingTask, this});
+            std::thread{&ThreadPoolImplBase::coptRunPendingTask, this, &slot});
       } catch (const std::system_error &err) {
+        _runningSlots.pop_back();
         MAF_LOGGER_WARN("Cannot launch new thread due to: ", err.what());
       }
     }
@@ -48,13 +87,18 @@ public:
 
   void run(Task task) { _taskQueue.push(std::move(task)); }
 
-  unsigned int maxThreadCount() const { return _maxThreadCount; }
+  unsigned int maxThreadCount() const {
+    std::lock_guard<std::mutex> lock(_poolMutex);
+    return _maxThreadCount;
+  }
 
   unsigned int activeThreadCount() {
+    std::lock_guard<std::mutex> lock(_poolMutex);
     return static_cast<unsigned int>(_pool.size());
   }
 
   void setMaxThreadCount(unsigned int nThreadCount) {
+    std::lock_guard<std::mutex> lock(_poolMutex);
     if (nThreadCount == 0) {
       _maxThreadCount = std::thread::hardware_concurrency();
     } else {
@@ -74,48 +118,42 @@ public:
   }
 
 private:
+  using RunningSlot = threading::RunningSlot<Task>;
+
   // copt = Called On Pool Threads
-  void coptRun(Task task) {
-    addToRunningTasks(task);
+  void coptRun(RunningSlot &slot, Task &task) {
+    slot.enter(task);
     _fRun(task);
-    removeFromRunningTasks(task);
+    slot.leave(task);
     _fDone(task);
   }
-  void coptRunPendingTask() {
+  void coptRunPendingTask(RunningSlot *slot) {
     Task task;
     while (_taskQueue.wait(task)) {
-      coptRun(task);
+      coptRun(*slot, task);
     }
   }
 
+  // Guards growth of the pool and of the slots, and their iteration while
+  // the pool is being stopped. Pool threads use their own slot without it.
+  mutable std::mutex _poolMutex;
   std::vector<std::thread> _pool;
+  // One per pool thread, deque keeps their addresses when it grows
+  std::deque<RunningSlot> _runningSlots;
+  bool _stopped = false;
   std::once_flag _shutdowned;
   TaskQueue _taskQueue;
-  std::list<Task> _runningTasks;
-  std::mutex _runningTaskMutex;
   unsigned int _maxThreadCount;
   TaskExc _fRun;
   TaskExc _fStop;
   TaskExc _fDone;
 
-  void addToRunningTasks(Task task) {
-    std::lock_guard<std::mutex> lock(_runningTaskMutex);
-    _runningTasks.push_back(std::move(task));
-  }
-  void removeFromRunningTasks(const Task &task) {
-    std::lock_guard<std::mutex> lock(_runningTaskMutex);
-    for (auto iTask = _runningTasks.begin(); iTask != _runningTasks.end();
-         ++iTask) {
-      if (*iTask == task) {
-        _runningTasks.erase(iTask);
-        break;
-      }
-    }
-  }
   void stopRunningTasks() {
-    std::lock_guard<std::mutex> lock(_runningTaskMutex);
-    for (auto &task : _runningTasks) {
-      _fStop(task);
+    std::lock_guard<std::mutex> lock(_poolMutex);
+    // The pool does not grow from now on, its threads can be joined unlocked
+    _stopped = true;
+    for (auto &slot : _runningSlots) {
+      slot.stop(_fStop);
     }
   }
 
@@ -1,18 +1,24 @@
 #include <maf/SignalSlots.h>
 #include <maf/logging/Logger.h>
 #include <maf/messaging/Processor.h>
+#include <maf/threading/CopyOnWrite.h>
 #include <maf/threading/Lockable.h>
-#include <maf/threading/Queue.h>
+#include <maf/threading/MPSCQueue.h>
 #include <maf/utils/CallOnExit.h>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <chrono>
 #include <cstring>
 #include <forward_list>
 #include <future>
-#include <map>
 #include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include "Router.h"
+#include "TimerDispatch.h"
 
 namespace maf {
 namespace messaging {
@@ -24,15 +30,41 @@ static void clearTLInstanceIfSet(bool set);
 static thread_local Processor *instance_ = nullptr;
 }  // namespace this_processor
 
-using ExecutionUPtr = std::unique_ptr<Execution>;
+using threading::Task;
 using Handlers = signal_slots::Signal<const Message &>;
 using HandlersPtr = std::shared_ptr<Handlers>;
-using PendingExecutions = threading::Queue<ExecutionUPtr>;
-using MsgHandlersMap = threading::Lockable<std::map<MessageID, HandlersPtr>>;
+
+// Task with the time it was queued at, which is only taken while metrics are
+// enabled. Time is kept beside the task rather than captured by a wrapping
+// one, then measuring never moves a task out of its inline storage.
+struct QueuedExecution {
+  Task task;
+  std::chrono::steady_clock::time_point enqueuedAt;
+};
+
+using PendingExecutions =
+    threading::PriorityMPSCQueue<QueuedExecution, PriorityCount>;
+using ExecutionBatch = std::vector<QueuedExecution>;
+using MsgHandlersMap =
+    threading::CopyOnWrite<std::unordered_map<MessageID, HandlersPtr>>;
+using ConflatedMessages =
+    threading::Lockable<std::unordered_map<MessageID, SharedMessage>>;
 using util::CallOnExit;
 using SSConnection = signal_slots::Connection;
 
 static inline constexpr auto anonymous_prefix = "[anonymous]."sv;
+static constexpr size_t DEFAULT_MAX_BATCH_SIZE = 128;
+
+// A Message is delivered as is, a SharedMessage lends its content to every
+// receiver
+static const Message &contentOf(const Message &msg) { return msg; }
+static const Message &contentOf(const SharedMessage &msg) {
+  return msg.content();
+}
+static SharedMessage share(Message msg) {
+  return SharedMessage{std::move(msg)};
+}
+static SharedMessage share(SharedMessage msg) { return msg; }
 
 class AsyncExecutor : public util::ExecutorIF {
   ProcessorRef compref;
@@ -69,58 +101,375 @@ class WaitableExecutor : public util::ExecutorIF {
   bool execute(CallbackType callback) noexcept override {
     if (auto comp = compref.lock()) {
       try {
-        comp->waitableExecute(callback).wait();
-        return true;
+        comp->waitableExecute(std::move(callback)).get();
       } catch (const std::future_error &e) {
-        MAF_LOGGER_ERROR("Cauth exception when execute callback: ", e.what());
+        MAF_LOGGER_WARN("Callback was dropped without being run: ", e.what());
         return false;
+      } catch (...) {
+        MAF_LOGGER_ERROR("Callback threw an exception");
       }
+      return true;
     }
     return false;
   }
 };
 
+// Recording side of ProcessorMetrics, counters are only updated by atomics so
+// that taking a snapshot never blocks the processor
+class AtomicHistogram {
+ public:
+  using Duration = DurationHistogram::Duration;
+
+  void record(Duration d) {
+    auto us = static_cast<uint64_t>(d.count());
+    buckets_[DurationHistogram::bucketOf(d)].fetch_add(
+        1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(us, std::memory_order_relaxed);
+    auto max = max_.load(std::memory_order_relaxed);
+    while (max < us &&
+           !max_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+  }
+
+  DurationHistogram snapshot() const {
+    DurationHistogram histogram;
+    for (size_t i = 0; i < DurationHistogram::BucketCount; ++i) {
+      histogram.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    histogram.count = count_.load(std::memory_order_relaxed);
+    histogram.total = Duration(total_.load(std::memory_order_relaxed));
+    histogram.max = Duration(max_.load(std::memory_order_relaxed));
+    return histogram;
+  }
+
+  void reset() {
+    for (auto &bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    total_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  std::array<std::atomic_uint64_t, DurationHistogram::BucketCount> buckets_ =
+      {};
+  std::atomic_uint64_t count_ = 0;
+  std::atomic_uint64_t total_ = 0;
+  std::atomic_uint64_t max_ = 0;
+};
+
+struct MetricsRecorder {
+  using Clock = std::chrono::steady_clock;
+  using HandlerTimes = threading::CopyOnWrite<
+      std::unordered_map<MessageID, std::shared_ptr<AtomicHistogram>>>;
+
+  std::atomic_bool enabled = false;
+  std::atomic<Clock::time_point> since = Clock::now();
+  std::atomic_size_t peakDepth = 0;
+  std::atomic_uint64_t executions = 0;
+  AtomicHistogram queueLatency;
+  // Histograms are never erased, only reset, then references to them stay
+  // valid
+  HandlerTimes handlerTimes;
+
+  void restart() {
+    peakDepth = 0;
+    executions = 0;
+    queueLatency.reset();
+    for (auto &[msgID, histogram] : *handlerTimes.read()) {
+      histogram->reset();
+    }
+    since = Clock::now();
+  }
+
+  void onEnqueued(size_t depth) {
+    auto peak = peakDepth.load(std::memory_order_relaxed);
+    while (peak < depth && !peakDepth.compare_exchange_weak(
+                               peak, depth, std::memory_order_relaxed)) {
+    }
+  }
+
+  void onDispatched(Clock::time_point enqueuedAt) {
+    executions.fetch_add(1, std::memory_order_relaxed);
+    queueLatency.record(std::chrono::duration_cast<AtomicHistogram::Duration>(
+        Clock::now() - enqueuedAt));
+  }
+
+  AtomicHistogram &handlerTimeOf(const MessageID &msgID) {
+    {
+      auto times = handlerTimes.read();
+      if (auto it = times->find(msgID); it != times->end()) {
+        return *it->second;
+      }
+    }
+    AtomicHistogram *histogram = nullptr;
+    handlerTimes.update([&](auto &times) {
+      auto &h = times[msgID];
+      if (!h) {
+        h = std::make_shared<AtomicHistogram>();
+      }
+      histogram = h.get();
+    });
+    return *histogram;
+  }
+
+  ProcessorMetrics snapshot(size_t depth) const {
+    using namespace std::chrono;
+    ProcessorMetrics metrics;
+    metrics.queueDepth = depth;
+    metrics.peakQueueDepth = std::max<size_t>(peakDepth, depth);
+    metrics.executions = executions;
+    auto elapsed = duration<double>(Clock::now() - since.load()).count();
+    if (elapsed > 0) {
+      metrics.executionsPerSecond = metrics.executions / elapsed;
+    }
+    metrics.queueLatency = queueLatency.snapshot();
+    for (auto &[msgID, histogram] : *handlerTimes.read()) {
+      metrics.handlerTimes.emplace(msgID, histogram->snapshot());
+    }
+    return metrics;
+  }
+};
+
 struct ProcessorDataPrv {
-  ProcessorDataPrv(ProcessorID id) : id{std::move(id)} {}
+  ProcessorDataPrv(ProcessorID id, QueueOptions queueOptions)
+      : id{std::move(id)}, queueOptions{std::move(queueOptions)} {
+    pendingExecutions.setLaneWeight(this->queueOptions.priorityWeight);
+  }
   ProcessorID id;
+  const QueueOptions queueOptions;
   PendingExecutions pendingExecutions;
+  std::atomic_size_t maxBatchSize = DEFAULT_MAX_BATCH_SIZE;
+  std::atomic_bool aboveHighWatermark = false;
+  ConflatedMessages conflatedMessages;
   MsgHandlersMap msgHandlersMap;
+  MetricsRecorder metrics;
 
-  bool addExecution(Execution e) {
+  bool addExecution(Task task, Priority priority, bool fromOwnThread) {
+    auto measured = metrics.enabled.load(std::memory_order_relaxed);
+    QueuedExecution execution{std::move(task), {}};
+    if (measured) {
+      execution.enqueuedAt = MetricsRecorder::Clock::now();
+    }
     try {
-      pendingExecutions.push(std::make_unique<Execution>(move(e)));
-      return true;
+      if (enqueue(execution, static_cast<size_t>(priority), fromOwnThread)) {
+        if (measured) {
+          metrics.onEnqueued(pendingExecutions.size());
+        }
+        checkHighWatermark();
+        return true;
+      }
     } catch (const std::bad_alloc &ba) {
       MAF_LOGGER_ERROR("Queue overflow: ", ba.what());
     }
     return false;
   }
 
-  void processMessage(const Message &msg) {
-    HandlersPtr handlers;
-    {
-      std::lock_guard lock(msgHandlersMap);
-      auto itHandler = msgHandlersMap->find(msg.type());
-      if (itHandler != msgHandlersMap->end()) {
-        handlers = itHandler->second;
+  bool enqueue(QueuedExecution &execution, size_t lane, bool fromOwnThread) {
+    auto capacity = queueOptions.capacity;
+    if (capacity == 0) {
+      return pendingExecutions.push(std::move(execution), lane);
+    }
+    switch (queueOptions.overflowPolicy) {
+      case OverflowPolicy::Block:
+        // Processor would wait for itself forever
+        return fromOwnThread
+                   ? pendingExecutions.push(std::move(execution), lane)
+                   : pendingExecutions.pushWhenRoom(std::move(execution),
+                                                    capacity, lane);
+      case OverflowPolicy::DropOldest:
+        while (!pendingExecutions.tryPush(std::move(execution), capacity,
+                                          lane)) {
+          if (pendingExecutions.isClosed()) {
+            return false;
+          }
+          pendingExecutions.dropOldest();
+        }
+        return true;
+      default:
+        return pendingExecutions.tryPush(std::move(execution), capacity, lane);
+    }
+  }
+
+  template <class Msg>
+  bool post(Msg msg, Priority priority, bool fromOwnThread) {
+    auto &msgType = contentOf(msg).type();
+    if (!msgConnected(msgType)) {
+      MAF_LOGGER_WARN("There's no handler for message ", msgType.name());
+      return false;
+    }
+    if (queueOptions.overflowPolicy == OverflowPolicy::Conflate) {
+      return postConflated(share(std::move(msg)), priority, fromOwnThread);
+    }
+    return addExecution(
+        [this, msg = std::move(msg)] { processMessage(contentOf(msg)); },
+        priority, fromOwnThread);
+  }
+
+  template <class Msg>
+  Processor::CompleteSignal waitablePost(Msg msg, bool fromOwnThread) {
+    auto &msgType = contentOf(msg).type();
+    if (!msgConnected(msgType)) {
+      MAF_LOGGER_WARN("There's no handler for message ", msgType.name());
+      return {};
+    }
+    threading::Promise<void> handled;
+    auto doneSignal = handled.getFuture();
+    if (fromOwnThread) {
+      handled.setResultOf([this, &msg] { processMessage(contentOf(msg)); });
+    } else {
+      // Promise is broken if the execution is dropped
+      addExecution(
+          [this, msg = std::move(msg), handled = std::move(handled)]() mutable {
+            handled.setResultOf(
+                [this, &msg] { processMessage(contentOf(msg)); });
+          },
+          Priority::Normal, false);
+    }
+    return doneSignal;
+  }
+
+  // Only the first message of a type is queued, later ones replace it until
+  // it is handled, keeping priority of the first one
+  bool postConflated(SharedMessage msg, Priority priority,
+                     bool fromOwnThread) {
+    auto msgType = MessageID{msg.type()};
+    std::lock_guard lock(conflatedMessages);
+    auto [itPending, isFirst] =
+        conflatedMessages->try_emplace(msgType, std::move(msg));
+    if (!isFirst) {
+      itPending->second = std::move(msg);
+      return true;
+    }
+    if (addExecution(
+            [this, msgType] {
+              if (auto msg = takeConflated(msgType); msg.valid()) {
+                processMessage(msg.content());
+              }
+            },
+            priority, fromOwnThread)) {
+      return true;
+    }
+    conflatedMessages->erase(itPending);
+    return false;
+  }
+
+  // Nothing if the entry was cleared by stop, or taken by an older task
+  // that ran after reuse
+  SharedMessage takeConflated(const MessageID &msgType) {
+    std::lock_guard lock(conflatedMessages);
+    auto itPending = conflatedMessages->find(msgType);
+    if (itPending == conflatedMessages->end()) {
+      return {};
+    }
+    auto msg = std::move(itPending->second);
+    conflatedMessages->erase(itPending);
+    return msg;
+  }
+
+  void checkHighWatermark() {
+    auto high = queueOptions.highWatermark;
+    if (high > 0 && !aboveHighWatermark.load(std::memory_order_relaxed) &&
+        pendingExecutions.size() >= high &&
+        !aboveHighWatermark.exchange(true) && queueOptions.onHighWatermark) {
+      queueOptions.onHighWatermark();
+    }
+  }
+
+  void checkLowWatermark() {
+    if (aboveHighWatermark.load(std::memory_order_relaxed) &&
+        pendingExecutions.size() <= queueOptions.lowWatermark &&
+        aboveHighWatermark.exchange(false) && queueOptions.onLowWatermark) {
+      queueOptions.onLowWatermark();
+    }
+  }
+
+  // Waits for executions until deadline or until next timer expires
+  template <class Wait, class WaitUntil>
+  bool waitExecutions(ExecutionDeadline deadline, Wait &&wait,
+                      WaitUntil &&waitUntil) {
+    auto wakeUp = std::min(deadline, details::nextTimerDeadline());
+    return wakeUp == ExecutionDeadline::max() ? wait() : waitUntil(wakeUp);
+  }
+
+  // Dispatches expired timers then one batch of executions, returns false
+  // once processor is stopped or deadline is reached with nothing to do
+  bool runOnce(ExecutionBatch &batch, ExecutionDeadline deadline) {
+    details::expireTimers();
+    if (pendingExecutions.isClosed()) {
+      return false;
+    }
+    auto batchSize = maxBatchSize.load(std::memory_order_relaxed);
+    auto taken = waitExecutions(
+        deadline,
+        [&] { return pendingExecutions.waitBatch(batch, batchSize); },
+        [&](auto wakeUp) {
+          return pendingExecutions.waitBatchUntil(batch, batchSize, wakeUp);
+        });
+    if (taken) {
+      runBatch(batch);
+      return true;
+    }
+    return !pendingExecutions.isClosed() &&
+           ExecutionDeadline::clock::now() < deadline;
+  }
+
+  // Executions left in batch after processor is stopped are dropped, as if
+  // they were cleared from the queue
+  void runBatch(ExecutionBatch &batch) {
+    CallOnExit clear = [&batch] { batch.clear(); };
+    checkLowWatermark();
+    for (auto &execution : batch) {
+      if (pendingExecutions.isClosed()) {
+        break;
       }
+      execute(execution);
+    }
+  }
+
+  void execute(QueuedExecution &execution) {
+    if (execution.enqueuedAt != MetricsRecorder::Clock::time_point{}) {
+      metrics.onDispatched(execution.enqueuedAt);
     }
+    execution.task();
+  }
 
-    if (handlers) {
+  void processMessage(const Message &msg) {
+    if (auto handlers = findHandlers(msg.type())) {
+      if (!metrics.enabled.load(std::memory_order_relaxed)) {
+        handlers->notify(msg);
+        return;
+      }
+      auto &handlerTime = metrics.handlerTimeOf(msg.type());
+      auto start = MetricsRecorder::Clock::now();
       handlers->notify(msg);
+      handlerTime.record(std::chrono::duration_cast<AtomicHistogram::Duration>(
+          MetricsRecorder::Clock::now() - start));
     }
   }
 
-  bool msgConnected(const MessageID &msgID) {
-    std::lock_guard lock(msgHandlersMap);
-    auto it = msgHandlersMap->find(msgID);
-    return it != msgHandlersMap->end() && it->second->connected();
+  HandlersPtr findHandlers(const MessageID &msgID) const {
+    auto handlersMap = msgHandlersMap.read();
+    auto it = handlersMap->find(msgID);
+    return it != handlersMap->end() ? it->second : nullptr;
   }
 
-  void cleanupUnconnectedMsgHandlers() {
-    for (auto it = msgHandlersMap->begin(); it != msgHandlersMap->end();) {
+  bool msgConnected(const MessageID &msgID) const {
+    auto handlersMap = msgHandlersMap.read();
+    auto it = handlersMap->find(msgID);
+    return it != handlersMap->end() && it->second->connected();
+  }
+
+  template <class OnErased>
+  static void cleanupUnconnectedMsgHandlers(
+      std::unordered_map<MessageID, HandlersPtr> &handlersMap,
+      OnErased &&onErased) {
+    for (auto it = handlersMap.begin(); it != handlersMap.end();) {
       if (!it->second->connected()) {
-        it = msgHandlersMap->erase(it);
+        onErased(it->first);
+        it = handlersMap.erase(it);
       } else {
         ++it;
       }
@@ -130,11 +479,12 @@ struct ProcessorDataPrv {
   void closeAndClearExecutionsQueue() {
     pendingExecutions.close();
     pendingExecutions.clear();
+    // Their tasks are gone, a later post must queue a new one
+    std::lock_guard lock(conflatedMessages);
+    conflatedMessages->clear();
   }
 };
 
-static decltype(auto) invoke(const ExecutionUPtr &exc) { return (*exc)(); }
-
 static const ProcessorID &emptyProcessorID() {
   static ProcessorID emptyID;
   return emptyID;
@@ -157,12 +507,13 @@ static void leaveRoutingIfNotAnonymous(ProcessorInstance comp) {
   }
 }
 
-Processor::Processor(ProcessorID id)
-    : d_{new ProcessorDataPrv{std::move(id)}} {}
+Processor::Processor(ProcessorID id, QueueOptions queueOptions)
+    : d_{new ProcessorDataPrv{std::move(id), std::move(queueOptions)}} {}
 
 Processor::~Processor() { d_->closeAndClearExecutionsQueue(); }
 
-ProcessorInstance Processor::create(ProcessorID id) {
+ProcessorInstance Processor::create(ProcessorID id,
+                                     QueueOptions queueOptions) {
   auto willJoinRouting = !id.empty();
   if (willJoinRouting) {
     assert(!isAnonymous(id));
@@ -173,14 +524,11 @@ ProcessorInstance Processor::create(ProcessorID id) {
     id = generateAnonymousID();
   }
 
-  auto comp = ProcessorInstance{new Processor{std::move(id)}};
+  auto comp = ProcessorInstance{
+      new Processor{std::move(id), std::move(queueOptions)}};
 
-  if (willJoinRouting) {
-    if (Router::instance().findProcessor(comp->id())) {
-      comp.reset();
-    } else {
-      Router::instance().addProcessor(comp);
-    }
+  if (willJoinRouting && !Router::instance().addProcessor(comp)) {
+    comp.reset();
   }
   return comp;
 }
@@ -204,45 +552,57 @@ void Processor::run(ThreadFunction threadInit, ThreadFunction threadDeinit) {
     this_processor::clearTLInstanceIfSet(justSet);
   };
 
-  ExecutionUPtr exc;
-  while (d_->pendingExecutions.wait(exc)) {
-    invoke(exc);
+  ExecutionBatch batch;
+  while (d_->runOnce(batch, ExecutionDeadline::max())) {
   }
 }
 
 void Processor::runFor(ExecutionTimeout duration) {
-  runUntil(std::chrono::system_clock::now() + duration);
+  runUntil(ExecutionDeadline::clock::now() + duration);
 }
 
 void Processor::runUntil(ExecutionDeadline deadline) {
-  ExecutionUPtr exc;
+  ExecutionBatch batch;
   auto justSet = this_processor::testAndSetThreadLocalInstance(this);
   CallOnExit deinit = [justSet] {
     this_processor::clearTLInstanceIfSet(justSet);
   };
 
-  while (d_->pendingExecutions.waitUntil(exc, deadline)) {
-    invoke(exc);
+  while (d_->runOnce(batch, deadline)) {
   }
 }
 
 bool Processor::runOnceFor(ExecutionTimeout duration) {
-  return runOnceUntil(std::chrono::system_clock::now() + duration);
+  return runOnceUntil(ExecutionDeadline::clock::now() + duration);
 }
 
 bool Processor::runOnceUntil(ExecutionDeadline deadline) {
   using namespace std::chrono;
-  ExecutionUPtr exc;
+  QueuedExecution exc;
   auto justSet = this_processor::testAndSetThreadLocalInstance(this);
   CallOnExit deinit = [justSet] {
     this_processor::clearTLInstanceIfSet(justSet);
   };
 
-  if (d_->pendingExecutions.waitUntil(exc, deadline)) {
-    invoke(exc);
-    return true;
+  // An expired timer counts as one execution
+  while (!stopped()) {
+    if (details::expireTimers() > 0) {
+      return true;
+    }
+    auto taken = d_->waitExecutions(
+        deadline, [&] { return d_->pendingExecutions.wait(exc); },
+        [&](auto wakeUp) {
+          return d_->pendingExecutions.waitUntil(exc, wakeUp);
+        });
+    if (taken) {
+      d_->checkLowWatermark();
+      d_->execute(exc);
+      return true;
+    }
+    if (ExecutionDeadline::clock::now() >= deadline) {
+      break;
+    }
   }
-
   return false;
 }
 
@@ -257,72 +617,81 @@ void Processor::reuse() { d_->pendingExecutions.reOpen(); }
 
 bool Processor::stopped() const { return d_->pendingExecutions.isClosed(); }
 
+void Processor::setMaxBatchSize(size_t size) {
+  d_->maxBatchSize = std::max<size_t>(size, 1);
+}
+
 bool Processor::post(Message msg) {
-  using namespace std;
-  if (!stopped()) {
-    auto &msgType = msg.type();
-    if (d_->msgConnected(msgType)) {
-      return executeAsync([msg = move(msg), this] { d_->processMessage(msg); });
-    } else {
-      MAF_LOGGER_WARN("There's no handler for message ", msgType.name());
-    }
-  }
-  return false;
+  return post(std::move(msg), Priority::Normal);
+}
+
+bool Processor::post(Message msg, Priority priority) {
+  return !stopped() ? d_->post(std::move(msg), priority,
+                               this_processor::instance_ == this)
+                    : false;
+}
+
+bool Processor::post(SharedMessage msg) {
+  return post(std::move(msg), Priority::Normal);
+}
+
+bool Processor::post(SharedMessage msg, Priority priority) {
+  return !stopped() ? d_->post(std::move(msg), priority,
+                               this_processor::instance_ == this)
+                    : false;
 }
 
 Processor::CompleteSignal Processor::waitablePost(Message msg) {
-  using namespace std;
-  CompleteSignal doneSignal;
-  if (!stopped()) {
-    auto &msgType = msg.type();
-    if (auto handlers = d_->msgConnected(msgType)) {
-      auto msgHandlingTask = make_shared<packaged_task<void()>>(
-          [this, msg = move(msg)] { d_->processMessage(msg); });
-
-      doneSignal = CompleteSignal{msgHandlingTask->get_future()};
-      if (this_processor::id() != id()) {
-        executeAsync([task{move(msgHandlingTask)}] { (*task)(); });
-      } else {
-        (*msgHandlingTask)();
-      }
-    } else {
-      MAF_LOGGER_WARN("There's no handler for message ", msgType.name());
-    }
-  }
-  return doneSignal;
+  return !stopped() ? d_->waitablePost(std::move(msg),
+                                       this_processor::instance_ == this)
+                    : CompleteSignal{};
+}
+
+Processor::CompleteSignal Processor::waitablePost(SharedMessage msg) {
+  return !stopped() ? d_->waitablePost(std::move(msg),
+                                       this_processor::instance_ == this)
+                    : CompleteSignal{};
 }
 
 bool Processor::connected(const MessageID &mid) const {
-  return d_->msgHandlersMap.atomic()->count(mid) > 0;
+  return d_->msgHandlersMap.read()->count(mid) > 0;
 }
 
-bool Processor::executeAsync(Execution exec) {
-  return !stopped() ? d_->addExecution(move(exec)) : false;
+bool Processor::executeAsync(Task task) {
+  return executeAsync(std::move(task), Priority::Normal);
 }
 
-bool Processor::execute(Execution exec) {
+bool Processor::executeAsync(Task task, Priority priority) {
+  return !stopped() ? d_->addExecution(std::move(task), priority,
+                                       this_processor::instance_ == this)
+                    : false;
+}
+
+bool Processor::execute(Task task) {
   using namespace std;
   if (!stopped()) {
     if (this_processor::instance().get() == this) {
-      exec();
+      task();
       return true;
     } else {
-      return d_->addExecution(move(exec));
+      return d_->addExecution(std::move(task), Priority::Normal, false);
     }
   }
   return false;
 }
 
-Processor::CompleteSignal Processor::waitableExecute(Execution exec) {
+Processor::CompleteSignal Processor::waitableExecute(Task task) {
   using namespace std;
   CompleteSignal doneSignal;
   if (!stopped()) {
-    auto task = make_shared<packaged_task<void()>>(move(exec));
-    doneSignal = CompleteSignal{task->get_future()};
+    threading::Promise<void> done;
+    doneSignal = done.getFuture();
     if (this_processor::id() != id()) {
-      executeAsync([task{move(task)}] { (*task)(); });
+      executeAsync([task = move(task), done = move(done)]() mutable {
+        done.setResultOf(task);
+      });
     } else {
-      (*task)();
+      done.setResultOf(task);
     }
   }
   return doneSignal;
@@ -367,22 +736,50 @@ Execution Processor::willBlockingExecuteOnThis(Execution exec) {
 MsgConnection Processor::connect(const MessageID &msgid,
                                  MessageProcessingCallback processMsgCallback) {
   using namespace std;
-  lock_guard lock(d_->msgHandlersMap);
-  auto &handlers = (*d_->msgHandlersMap)[msgid];
-  if (!handlers) {
-    handlers = std::make_shared<Handlers>();
-  }
-  return new SSConnection(handlers->connect(move(processMsgCallback)));
+  SSConnection *connection = nullptr;
+  // Connect while publishing, so that disconnect can't clean up the handlers
+  // in between. Router index is updated under the same writer lock, then it
+  // follows the handlers map in order.
+  d_->msgHandlersMap.update([&](auto &handlersMap) {
+    auto &handlers = handlersMap[msgid];
+    if (!handlers) {
+      handlers = std::make_shared<Handlers>();
+      if (!isAnonymous(id())) {
+        Router::instance().subscribe(shared_from_this(), msgid);
+      }
+    }
+    connection = new SSConnection(handlers->connect(move(processMsgCallback)));
+  });
+  return connection;
 }
 
 void Processor::disconnect(const MessageID &msgid) {
-  std::lock_guard lock(d_->msgHandlersMap);
-  d_->msgHandlersMap->erase(msgid);
-  d_->cleanupUnconnectedMsgHandlers();
+  d_->msgHandlersMap.update([this, &msgid](auto &handlersMap) {
+    auto unsubscribe = [this](const MessageID &erased) {
+      if (!isAnonymous(id())) {
+        Router::instance().unsubscribe(shared_from_this(), erased);
+      }
+    };
+    if (handlersMap.erase(msgid) != 0) {
+      unsubscribe(msgid);
+    }
+    ProcessorDataPrv::cleanupUnconnectedMsgHandlers(handlersMap, unsubscribe);
+  });
 }
 
 size_t Processor::pendingCout() const { return d_->pendingExecutions.size(); }
 
+void Processor::setMetricsEnabled(bool enabled) {
+  if (enabled) {
+    d_->metrics.restart();
+  }
+  d_->metrics.enabled = enabled;
+}
+
+ProcessorMetrics Processor::metrics() const {
+  return d_->metrics.snapshot(d_->pendingExecutions.size());
+}
+
 namespace this_processor {
 
 static bool testAndSetThreadLocalInstance(Processor *inst) {
@@ -435,24 +832,34 @@ bool post(Message msg) {
   return comp ? comp->post(move(msg)) : false;
 }
 
+bool post(Message msg, Priority priority) {
+  auto comp = instance();
+  return comp ? comp->post(move(msg), priority) : false;
+}
+
 Processor::CompleteSignal waitablePost(Message msg) {
   auto comp = instance();
   return comp ? comp->waitablePost(move(msg)) : CompleteSignal{};
 }
 
-bool executeAsync(Execution exec) {
+bool executeAsync(Task task) {
+  auto comp = instance();
+  return comp ? comp->executeAsync(std::move(task)) : false;
+}
+
+bool executeAsync(Task task, Priority priority) {
   auto comp = instance();
-  return comp ? comp->executeAsync(move(exec)) : false;
+  return comp ? comp->executeAsync(std::move(task), priority) : false;
 }
 
-bool execute(Execution exec) {
+bool execute(Task task) {
   auto comp = instance();
-  return comp ? comp->execute(move(exec)) : false;
+  return comp ? comp->execute(std::move(task)) : false;
 }
 
-CompleteSignal waitableExecute(Execution exec) {
+CompleteSignal waitableExecute(Task task) {
   auto comp = instance();
-  return comp ? comp->waitableExecute(move(exec)) : CompleteSignal{};
+  return comp ? comp->waitableExecute(std::move(task)) : CompleteSignal{};
 }
 
 Processor::Executor getAsyncExecutor() {
@@ -545,8 +952,8 @@ void MsgConnection::reconnect() {
   }
 }
 
-ProcessorInstance makeProcessor(ProcessorID id) {
-  return Processor::create(move(id));
+ProcessorInstance makeProcessor(ProcessorID id, QueueOptions queueOptions) {
+  return Processor::create(std::move(id), std::move(queueOptions));
 }
 
 }  // namespace messaging
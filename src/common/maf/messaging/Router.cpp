@@ -1,5 +1,6 @@
 #include "Router.h"
 
+#include <algorithm>
 #include <vector>
 
 namespace maf {
@@ -7,14 +8,21 @@ namespace messaging {
 namespace details {
 using namespace std;
 
-static bool askThenPost(const ProcessorInstance &r, Message msg);
-static Processor::CompleteSignal askThenSend(const ProcessorInstance &r,
-                                             Message msg);
-static void notifyAllAboutNewProcessor(const Processors &joinedProcessors,
+static void notifyAllAboutNewProcessor(const SubscribersPtr &subscribers,
                                        const ProcessorInstance &newProcessor);
 static void informNewProcessorAboutJoinedOnes(
     const ProcessorInstance &newProcessor, const Processors &joinedProcessors);
 
+// Registration mutex must be held
+template <class Modify>
+void Router::updateRegistry(Modify &&modify) {
+  registry_.update([&modify](RegistrySnapshot &registry) {
+    auto fresh = make_shared<Registry>(*registry);
+    modify(*fresh);
+    registry = move(fresh);
+  });
+}
+
 bool Router::post(const ProcessorID &messageprocessorID, Message &&msg) {
   if (auto comp = findProcessor(messageprocessorID)) {
     return comp->post(std::move(msg));
@@ -30,95 +38,173 @@ Processor::CompleteSignal Router::send(const ProcessorID &messageprocessorID,
   return {};
 }
 
-bool Router::postToAll(const Message &msg) {
+bool Router::postToAll(const SharedMessage &msg) {
   bool delivered = false;
-  auto atProcessors = messageprocessors_.atomic();
-  for (const auto &comp : *atProcessors) {
-    delivered |= askThenPost(comp, std::move(msg));
+  if (auto subscribers = subscribersOf(msg.type())) {
+    for (const auto &comp : *subscribers) {
+      delivered |= comp->post(msg);
+    }
   }
   return delivered;
 }
 
-Processor::CompleteSignal Router::sendToAll(const Message &msg) {
+Processor::CompleteSignal Router::sendToAll(const SharedMessage &msg) {
   auto msgMessageHandledSignals = vector<Processor::CompleteSignal>{};
-  auto atProcessors = messageprocessors_.atomic();
-  for (const auto &comp : *atProcessors) {
-    if (auto sig = askThenSend(comp, std::move(msg)); sig.valid()) {
-      msgMessageHandledSignals.emplace_back(move(sig));
+  if (auto subscribers = subscribersOf(msg.type())) {
+    for (const auto &comp : *subscribers) {
+      if (auto sig = comp->waitablePost(msg); sig.valid()) {
+        msgMessageHandledSignals.emplace_back(move(sig));
+      }
     }
   }
 
   if (!msgMessageHandledSignals.empty()) {
-    return Processor::CompleteSignal{async(
-        launch::deferred, [sigs{move(msgMessageHandledSignals)}]() mutable {
-          for (auto &sig : sigs) {
-            sig.get();
-          }
-        })};
+    // Completes on the thread that handles the last message, nobody waits
+    return threading::whenAll(move(msgMessageHandledSignals))
+        .then([](auto &&) {});
   } else {
     return {};
   }
 }
 
 ProcessorInstance Router::findProcessor(const ProcessorID &id) const {
-  auto atProcessors = messageprocessors_.atomic();
-  if (auto itProcessor = atProcessors->find(id);
-      itProcessor != atProcessors->end()) {
-    return *itProcessor;
+  auto registry = registry_.read();
+  auto &processors = (*registry)->processors;
+  if (auto itProcessor = processors.find(id); itProcessor != processors.end()) {
+    return itProcessor->second;
   }
   return {};
 }
 
 bool Router::addProcessor(ProcessorInstance comp) {
-  if (comp) {
-    auto joinedProcessors = messageprocessors_.atomic();
-    if (joinedProcessors->count(comp) == 0) {
-      informNewProcessorAboutJoinedOnes(comp, *joinedProcessors);
-      notifyAllAboutNewProcessor(*joinedProcessors, comp);
-      joinedProcessors->insert(move(comp));
+  if (!comp) {
+    return false;
+  }
+  RegistrySnapshot joined;
+  {
+    std::lock_guard lock(registrationMutex_);
+    joined = snapshot();
+    if (joined->processors.count(comp->id()) != 0) {
+      return false;
     }
+    updateRegistry([&comp](Registry &registry) {
+      registry.processors.emplace(comp->id(), comp);
+    });
   }
-  return false;
+  // Posted outside the lock, as in removeProcessor: a post blocked by a full
+  // queue must not hold up joins and subscriptions
+  informNewProcessorAboutJoinedOnes(comp, joined->processors);
+  auto &subscribers = joined->subscribers;
+  if (auto it = subscribers.find(msgid<ProcessorStatusUpdateMsg>());
+      it != subscribers.end()) {
+    notifyAllAboutNewProcessor(it->second, comp);
+  }
+  return true;
 }
 
 bool Router::removeProcessor(const ProcessorInstance &comp) {
-  if (messageprocessors_.atomic()->erase(comp) != 0) {
-    postToAll(ProcessorStatusUpdateMsg{
-        comp, ProcessorStatusUpdateMsg::Status::UnReachable});
-    return true;
+  {
+    std::lock_guard lock(registrationMutex_);
+    auto joined = snapshot();
+    auto itProcessor = joined->processors.find(comp->id());
+    if (itProcessor == joined->processors.end() ||
+        itProcessor->second != comp) {
+      return false;
+    }
+    updateRegistry([&comp](Registry &registry) {
+      registry.processors.erase(comp->id());
+      for (auto it = registry.subscribers.begin();
+           it != registry.subscribers.end();) {
+        auto &subscribers = *it->second;
+        if (find(subscribers.begin(), subscribers.end(), comp) ==
+            subscribers.end()) {
+          ++it;
+          continue;
+        }
+        auto rest = make_shared<Subscribers>();
+        remove_copy(subscribers.begin(), subscribers.end(),
+                    back_inserter(*rest), comp);
+        if (rest->empty()) {
+          it = registry.subscribers.erase(it);
+        } else {
+          it->second = move(rest);
+          ++it;
+        }
+      }
+    });
   }
-  return false;
+  postToAll(makeSharedMessage<ProcessorStatusUpdateMsg>(
+      comp, ProcessorStatusUpdateMsg::Status::UnReachable));
+  return true;
 }
 
-static bool askThenPost(const ProcessorInstance &r, Message msg) {
-  if (r->connected(msg.type())) {
-    return r->post(std::move(msg));
+void Router::subscribe(const ProcessorInstance &comp, const MessageID &msgid) {
+  std::lock_guard lock(registrationMutex_);
+  auto joined = snapshot();
+  if (auto itProcessor = joined->processors.find(comp->id());
+      itProcessor == joined->processors.end() || itProcessor->second != comp) {
+    return;
   }
-  return false;
+  updateRegistry([&comp, &msgid](Registry &registry) {
+    auto &subscribers = registry.subscribers[msgid];
+    auto more = subscribers ? make_shared<Subscribers>(*subscribers)
+                            : make_shared<Subscribers>();
+    if (find(more->begin(), more->end(), comp) == more->end()) {
+      more->push_back(comp);
+      subscribers = move(more);
+    }
+  });
+}
+
+void Router::unsubscribe(const ProcessorInstance &comp,
+                         const MessageID &msgid) {
+  std::lock_guard lock(registrationMutex_);
+  auto joined = snapshot();
+  auto itSubscribers = joined->subscribers.find(msgid);
+  if (itSubscribers == joined->subscribers.end() ||
+      find(itSubscribers->second->begin(), itSubscribers->second->end(),
+           comp) == itSubscribers->second->end()) {
+    return;
+  }
+  updateRegistry([&comp, &msgid](Registry &registry) {
+    auto &subscribers = registry.subscribers[msgid];
+    auto rest = make_shared<Subscribers>();
+    remove_copy(subscribers->begin(), subscribers->end(), back_inserter(*rest),
+                comp);
+    if (rest->empty()) {
+      registry.subscribers.erase(msgid);
+    } else {
+      subscribers = move(rest);
+    }
+  });
 }
 
-static Processor::CompleteSignal askThenSend(const ProcessorInstance &r,
-                                             Message msg) {
-  if (r->connected(msg.type())) {
-    return r->waitablePost(std::move(msg));
+Router::RegistrySnapshot Router::snapshot() const { return *registry_.read(); }
+
+SubscribersPtr Router::subscribersOf(const MessageID &msgid) const {
+  auto registry = registry_.read();
+  auto &subscribers = (*registry)->subscribers;
+  if (auto it = subscribers.find(msgid); it != subscribers.end()) {
+    return it->second;
   }
   return {};
 }
 
-static void notifyAllAboutNewProcessor(const Processors &joinedProcessors,
+static void notifyAllAboutNewProcessor(const SubscribersPtr &subscribers,
                                        const ProcessorInstance &newProcessor) {
-  auto msg = ProcessorStatusUpdateMsg{
-      newProcessor, ProcessorStatusUpdateMsg::Status::Reachable};
-
-  for (const auto &joinedProcessor : joinedProcessors) {
-    askThenPost(joinedProcessor, msg);
+  if (subscribers) {
+    auto msg = makeSharedMessage<ProcessorStatusUpdateMsg>(
+        newProcessor, ProcessorStatusUpdateMsg::Status::Reachable);
+    for (const auto &joinedProcessor : *subscribers) {
+      joinedProcessor->post(msg);
+    }
   }
 }
 
 static void informNewProcessorAboutJoinedOnes(
     const ProcessorInstance &newProcessor, const Processors &joinedProcessors) {
   if (newProcessor->connected(msgid<ProcessorStatusUpdateMsg>())) {
-    for (const auto &joinedOne : joinedProcessors) {
+    for (const auto &[id, joinedOne] : joinedProcessors) {
       newProcessor->post<ProcessorStatusUpdateMsg>(
           joinedOne, ProcessorStatusUpdateMsg::Status::Reachable);
     }
@@ -3,50 +3,60 @@
 #include <maf/messaging/Processor.h>
 #include <maf/messaging/Routing.h>
 #include <maf/patterns/Patterns.h>
-#include <maf/threading/Lockable.h>
+#include <maf/threading/CopyOnWrite.h>
 
+#include <memory>
 #include <mutex>
-#include <set>
+#include <unordered_map>
+#include <vector>
 
 namespace maf {
 namespace messaging {
 namespace details {
 using namespace routing;
 
-struct ProcessorCompare {
-  typedef int is_transparent;
-  bool operator()(const ProcessorInstance &r1,
-                  const ProcessorInstance &r2) const {
-    return r1 != r2 && r1->id() < r2->id();
-  }
+using Processors = std::unordered_map<ProcessorID, ProcessorInstance>;
+using Subscribers = std::vector<ProcessorInstance>;
+using SubscribersPtr = std::shared_ptr<const Subscribers>;
 
-  bool operator()(const ProcessorInstance &r, const ProcessorID &id) const {
-    return r->id() < id;
-  }
-
-  bool operator()(const ProcessorID &id, const ProcessorInstance &r) const {
-    return id < r->id();
-  }
+// Named processors, and for each message type the ones connected to it, then
+// broadcasting visits subscribers only
+struct Registry {
+  Processors processors;
+  std::unordered_map<MessageID, SubscribersPtr> subscribers;
 };
 
-using Processors = std::set<ProcessorInstance, ProcessorCompare>;
-
 class Router : public pattern::SingletonObject<Router> {
  public:
   Router(Invisible) noexcept {}
   bool post(const ProcessorID &messageprocessorID, Message &&msg);
   Processor::CompleteSignal send(const ProcessorID &messageprocessorID, Message msg);
-  bool postToAll(const Message &msg);
-  Processor::CompleteSignal sendToAll(const Message &msg);
+  bool postToAll(const SharedMessage &msg);
+  Processor::CompleteSignal sendToAll(const SharedMessage &msg);
 
   ProcessorInstance findProcessor(const ProcessorID &id) const;
   bool addProcessor(ProcessorInstance comp);
   bool removeProcessor(const ProcessorInstance &comp);
+  // Called by a joined processor when it gets its first handler of msgid or
+  // loses the last one
+  void subscribe(const ProcessorInstance &comp, const MessageID &msgid);
+  void unsubscribe(const ProcessorInstance &comp, const MessageID &msgid);
 
  private:
-  using AtomicProcessors = threading::Lockable<Processors, std::mutex>;
+  // Registry is an immutable snapshot, replaced as a whole when a processor
+  // joins, leaves or changes subscriptions. Senders never lock, broadcasting
+  // keeps its own snapshot then doesn't hold back registration.
+  using RegistrySnapshot = std::shared_ptr<const Registry>;
+
+  RegistrySnapshot snapshot() const;
+  SubscribersPtr subscribersOf(const MessageID &msgid) const;
+  template <class Modify>
+  void updateRegistry(Modify &&modify);
 
-  AtomicProcessors messageprocessors_;
+  threading::CopyOnWrite<RegistrySnapshot> registry_{
+      std::make_shared<const Registry>()};
+  // Serializes registry updates with notifications about them
+  std::mutex registrationMutex_;
 };
 
 }  // namespace details
@@ -11,7 +11,11 @@ bool post(const ProcessorID &messageprocessorID, Message msg) {
 }
 
 bool postToAll(Message msg) {
-  return Router::instance().postToAll(std::move(msg));
+  return Router::instance().postToAll(SharedMessage{std::move(msg)});
+}
+
+bool postToAll(SharedMessage msg) {
+  return Router::instance().postToAll(msg);
 }
 
 ProcessorInstance findProcessor(const ProcessorID &id) {
@@ -24,7 +28,11 @@ Processor::CompleteSignal send(const ProcessorID &messageprocessorID,
 }
 
 Processor::CompleteSignal sendToAll(Message msg) {
-  return Router::instance().sendToAll(std::move(msg));
+  return Router::instance().sendToAll(SharedMessage{std::move(msg)});
+}
+
+Processor::CompleteSignal sendToAll(SharedMessage msg) {
+  return Router::instance().sendToAll(msg);
 }
 
 }  // namespace routing
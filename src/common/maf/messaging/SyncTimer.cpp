@@ -6,25 +6,173 @@
 #include <cassert>
 #include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <vector>
+
+#include "TimingWheel.h"
 
 namespace maf {
 
 namespace messaging {
 
-struct SyncTimerDataPrv {
-  std::condition_variable_any timeoutCondition;
-  std::recursive_mutex mutex;
-  bool running = false;
-  bool cyclic = false;
+using namespace std::chrono;
+using TimeOutCallback = SyncTimer::TimeOutCallback;
+using ExecutorIFPtr = std::shared_ptr<util::ExecutorIF>;
+
+// Fields other than the atomic ones are guarded by the service mutex
+struct SyncTimerDataPrv : details::TimingWheelNode {
+  TimeOutCallback callback;
+  ExecutorIFPtr executor;
+  milliseconds duration{0};
+  uint64_t due = 0;
+  // Changed by every start/stop, an expiry of an older run is not fired
+  uint64_t run = 0;
+  std::atomic_bool running = false;
+  std::atomic_bool cyclic = false;
+  std::atomic_bool started = false;
+  // Keeps the record alive while it is in the wheel
+  std::shared_ptr<SyncTimerDataPrv> self;
 };
 
-SyncTimer::SyncTimer(bool cyclic)
-    : d_{new SyncTimerDataPrv{{}, {}, false, cyclic}} {}
+using SyncTimerDataPtr = std::shared_ptr<SyncTimerDataPrv>;
+
+// One thread for all SyncTimers of the process, callbacks are called on it
+// or posted to executor of their timer. One tick of the wheel is one
+// millisecond.
+// The service is never destroyed, so SyncTimers that are static objects or
+// owned by ones can still be stopped during static destruction. Its thread
+// runs until the process exits.
+class TimerService : public pattern::Unasignable {
+  using Clock = details::TickClock::Clock;
+  struct Expired {
+    SyncTimerDataPtr record;
+    uint64_t run;
+  };
+
+ public:
+  static TimerService &instance() {
+    static auto service = new TimerService;
+    return *service;
+  }
+
+  void start(const SyncTimerDataPtr &record, milliseconds duration,
+             TimeOutCallback callback, ExecutorIFPtr executor) {
+    std::lock_guard lock(mutex_);
+    record->duration = duration;
+    record->callback = std::move(callback);
+    record->executor = std::move(executor);
+    schedule(record);
+  }
+
+  void restart(const SyncTimerDataPtr &record) {
+    std::lock_guard lock(mutex_);
+    if (record->running) {
+      schedule(record);
+    }
+  }
+
+  void stop(const SyncTimerDataPtr &record) {
+    std::unique_lock lock(mutex_);
+    ++record->run;
+    record->running = false;
+    if (record->linked()) {
+      wheel_.remove(*record);
+      record->self.reset();
+    }
+    // After stop returns its callback is not being called, except when it
+    // stops itself
+    if (std::this_thread::get_id() != thread_.get_id()) {
+      dispatched_.wait(lock, [this, &record] { return firing_ != record; });
+    }
+  }
 
-SyncTimer::~SyncTimer() {
-  stop();
-  delete d_;
+ private:
+  TimerService() : thread_{[this] { run(); }} {}
+
+  void schedule(const SyncTimerDataPtr &record) {
+    wheel_.remove(*record);
+    ++record->run;
+    record->running = true;
+    record->self = record;
+    record->due = ticks_.tickOf(Clock::now() + record->duration);
+    wheel_.insert(*record, record->due);
+    if (ticks_.timeOf(record->expiry) < waitingUntil_) {
+      wakeUp_.notify_one();
+    }
+  }
+
+  void run() {
+    std::unique_lock lock(mutex_);
+    std::vector<Expired> expired;
+    while (true) {
+      wheel_.advance(ticks_.now(), [this, &expired](auto &node) {
+        auto &record = static_cast<SyncTimerDataPrv &>(node);
+        expired.push_back({record.self, record.run});
+        if (record.cyclic) {
+          // Next period counts from when it was due
+          record.due += details::TickClock::ticksOf(record.duration);
+          wheel_.insert(record, record.due);
+        } else {
+          record.self.reset();
+        }
+      });
+      for (auto &[record, run] : expired) {
+        fire(lock, record, run);
+      }
+      expired.clear();
+
+      waitingUntil_ = wheel_.empty() ? Clock::time_point::max()
+                                     : ticks_.timeOf(wheel_.nextTick());
+      if (waitingUntil_ == Clock::time_point::max()) {
+        wakeUp_.wait(lock);
+      } else {
+        wakeUp_.wait_until(lock, waitingUntil_);
+      }
+      waitingUntil_ = Clock::time_point::min();
+    }
+  }
+
+  void fire(std::unique_lock<std::mutex> &lock, const SyncTimerDataPtr &record,
+            uint64_t run) {
+    if (record->run != run || !record->running) {
+      return;
+    }
+    if (!record->cyclic) {
+      record->running = false;
+    }
+    // Callback may start its timer again with another one
+    auto callback = record->callback;
+    if (auto executor = record->executor) {
+      lock.unlock();
+      executor->execute(std::move(callback));
+      lock.lock();
+    } else {
+      firing_ = record;
+      lock.unlock();
+      callback();
+      lock.lock();
+      firing_.reset();
+      dispatched_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable wakeUp_;
+  std::condition_variable dispatched_;
+  details::TimingWheel wheel_;
+  details::TickClock ticks_;
+  // min while the service thread is busy, no need to wake it up
+  Clock::time_point waitingUntil_ = Clock::time_point::min();
+  SyncTimerDataPtr firing_;
+  std::thread thread_;
+};
+
+SyncTimer::SyncTimer(bool cyclic) : d_{std::make_shared<SyncTimerDataPrv>()} {
+  d_->cyclic = cyclic;
 }
+
+SyncTimer::~SyncTimer() { stop(); }
+
 void SyncTimer::start(long long milliseconds, TimeOutCallback callback,
                       ExecutorIFPtr executor) {
   start(std::chrono::milliseconds{milliseconds}, std::move(callback),
@@ -36,51 +184,27 @@ void SyncTimer::start(std::chrono::milliseconds milliseconds,
   if (!callback) {
     MAF_LOGGER_ERROR("[TimerImpl]: Please specify not null callback");
   } else {
-    if (running()) {
-      MAF_LOGGER_INFO("TimerImpl is still running, then stop!");
-      stop();
-    }
-
-    std::unique_lock lock(d_->mutex);
-    d_->running = true;
-
-    do {
-      if (!d_->timeoutCondition.wait_for(lock, milliseconds,
-                                         [this] { return !d_->running; })) {
-        if (executor) {
-          executor->execute(d_->cyclic ? callback : std::move(callback));
-        } else {
-          callback();
-        }
-      }
-
-      if (!d_->running)  // restarted
-      {
-        break;
-      }
-
-    } while (d_->cyclic);
-
-    d_->running = false;
+    d_->started = true;
+    TimerService::instance().start(d_, milliseconds, std::move(callback),
+                                   std::move(executor));
   }
 }
 
-void SyncTimer::restart() { d_->timeoutCondition.notify_one(); }
+void SyncTimer::restart() {
+  if (d_->started) {
+    TimerService::instance().restart(d_);
+  }
+}
 
 void SyncTimer::stop() {
-  std::lock_guard lock(d_->mutex);
-  if (d_->running) {
-    d_->running = false;
-    d_->timeoutCondition.notify_one();
+  if (d_->started) {
+    TimerService::instance().stop(d_);
   }
 }
 
 bool SyncTimer::running() { return d_->running; }
 
-void SyncTimer::setCyclic(bool cyclic) {
-  std::lock_guard lock(d_->mutex);
-  d_->cyclic = cyclic;
-}
+void SyncTimer::setCyclic(bool cyclic) { d_->cyclic = cyclic; }
 
 }  // namespace messaging
 }  // namespace maf
@@ -5,86 +5,65 @@
 #include <algorithm>
 #include <cassert>
 #include <memory>
-#include <thread>
 #include <vector>
 
+#include "TimerDispatch.h"
+#include "TimingWheel.h"
+
 namespace maf {
 namespace messaging {
 
 struct TimerData;
-struct TimerInterrupt;
 struct TimerMgr;
 using namespace std::chrono;
-using Clock = system_clock;
-using DeadLine = ExecutionDeadline;
 using TimeOutCallback = Timer::TimeOutCallback;
-using std::make_heap;
 using std::make_shared;
 using std::move;
-using std::pop_heap;
-using std::push_heap;
 using std::shared_ptr;
 using TimerDataPtr = shared_ptr<TimerData>;
+using details::TimingWheel;
 using util::ExecutorIFPtr;
 
-struct TimerData {
+struct TimerData : details::TimingWheelNode {
   TimeOutCallback callback;
-  DeadLine deadline = Clock::now();
-  ExecutionTimeout duration;
+  ExecutionTimeout duration{0};
+  milliseconds slack{0};
+  // Tick the timer is due at, it expires at most slack later
+  uint64_t due = 0;
   bool cyclic = false;
   bool running = false;
+  // Wheel of the thread the timer runs on
+  TimerMgr* owner = nullptr;
+  // Keeps the record alive while it is in the wheel, then its Timer can be
+  // destroyed from another thread
+  TimerDataPtr self;
 
-  TimerData() = default;
-  TimerData(TimeOutCallback cb, ExecutionTimeout interval, bool cc = false)
-      : callback(move(cb)),
-        deadline(Clock::now() + interval),
-        duration(interval),
-        cyclic(cc) {}
-  void updateNextDeadline() { deadline += duration; }
-  void restart() {
-    running = true;
-    deadline = Clock::now() + duration;
-  }
-  bool expired() const { return deadline <= Clock::now(); }
-  void onExpired() { callback(); }
-  void reset(TimeOutCallback&& cb, ExecutionTimeout d, bool cc = false) {
+  void reset(TimeOutCallback&& cb, ExecutionTimeout d, milliseconds s) {
     callback = move(cb);
-    deadline = Clock::now() + d;
     duration = d;
-    cyclic = cc;
+    slack = s;
   }
+  void onExpired() { callback(); }
 };
 
-static bool timerGreater(const TimerDataPtr& t1, const TimerDataPtr& t2) {
-  return t1->deadline > t2->deadline;
-}
-
+// One tick of the wheel is one millisecond, a timer never expires before its
+// duration is over
 struct TimerMgr {
-  using Heap = std::vector<TimerDataPtr>;
-  enum class State : char { NoTimer, HaveTimer, Waiting };
-  Heap records_;
-  State state_ = State::NoTimer;
-
-  void cleanup();
-  void refresh();
-  void checkAllTimers();
-  void start(TimerDataPtr record);
-  void stop(TimerDataPtr record);
-  void onTimerModified();
-  void onShortestTimerExpired(const TimerDataPtr& record);
-  void restart(const TimerDataPtr& r);
-  void add(TimerDataPtr newRecord);
-  bool remove(TimerDataPtr tm);
-  TimerDataPtr getShortestTimer();
-  TimerDataPtr removeShortestTimer();
-  void updateShortestTimer();
-  void interruptCurrentTimer(const ProcessorInstance& comp);
-  bool checkRecordListEmpty();
-
-  decltype(auto) begin() { return std::begin(records_); }
-  decltype(auto) end() { return std::end(records_); }
-  decltype(auto) begin() const { return std::begin(records_); }
-  decltype(auto) end() const { return std::end(records_); }
+  using Clock = details::TickClock::Clock;
+
+  TimingWheel wheel_;
+  details::TickClock ticks_;
+
+  ~TimerMgr();
+  size_t expire();
+  ExecutionDeadline nextDeadline() const;
+  void start(const TimerDataPtr& record);
+  void stop(const TimerDataPtr& record);
+  void restart(const TimerDataPtr& record);
+  bool onExpired(TimerData& record);
+  void schedule(TimerData& record);
+  void unschedule(TimerData& record);
+  uint64_t coalescedTick(uint64_t due, uint64_t slack) const;
 };
 
 static TimerMgr& mgr() {
@@ -93,8 +72,8 @@ static TimerMgr& mgr() {
 }
 
 static void runTimer(const TimerDataPtr& tm, milliseconds interval,
-                     TimeOutCallback&& callback) {
-  tm->reset(move(callback), interval, tm->cyclic);
+                     milliseconds slack, TimeOutCallback&& callback) {
+  tm->reset(move(callback), interval, slack);
   mgr().start(tm);
 }
 
@@ -106,8 +85,13 @@ void Timer::start(long long milliseconds, TimeOutCallback callback) {
 }
 void Timer::start(std::chrono::milliseconds interval,
                   TimeOutCallback callback) {
+  start(interval, milliseconds{0}, move(callback));
+}
+
+void Timer::start(milliseconds interval, milliseconds slack,
+                  TimeOutCallback callback) {
   assert(callback);
-  runTimer(d_, interval, move(callback));
+  runTimer(d_, interval, slack, move(callback));
 }
 
 void Timer::start(long long milliseconds, Timer::TimeOutCallback callback,
@@ -117,9 +101,15 @@ void Timer::start(long long milliseconds, Timer::TimeOutCallback callback,
 
 void Timer::start(milliseconds milliseconds, Timer::TimeOutCallback callback,
                   const ProcessorInstance& comp) {
+  start(milliseconds, std::chrono::milliseconds{0}, move(callback), comp);
+}
+
+void Timer::start(milliseconds interval, milliseconds slack,
+                  Timer::TimeOutCallback callback,
+                  const ProcessorInstance& comp) {
   comp->executeAsync(
-      [timerData = d_, callback{move(callback)}, milliseconds]() mutable {
-        runTimer(timerData, milliseconds, move(callback));
+      [timerData = d_, callback{move(callback)}, interval, slack]() mutable {
+        runTimer(timerData, interval, slack, move(callback));
       });
 }
 
@@ -146,8 +136,13 @@ void Timer::timeoutAfter(long long ms, Timer::TimeOutCallback callback) {
 
 void Timer::timeoutAfter(milliseconds milliseconds,
                          Timer::TimeOutCallback callback) {
+  timeoutAfter(milliseconds, std::chrono::milliseconds{0}, move(callback));
+}
+
+void Timer::timeoutAfter(milliseconds interval, milliseconds slack,
+                         Timer::TimeOutCallback callback) {
   auto tm = make_shared<TimerData>();
-  runTimer(tm, milliseconds, move(callback));
+  runTimer(tm, interval, slack, move(callback));
 }
 
 void Timer::timeoutAfter(long long ms, Timer::TimeOutCallback callback,
@@ -158,154 +153,139 @@ void Timer::timeoutAfter(long long ms, Timer::TimeOutCallback callback,
 void Timer::timeoutAfter(milliseconds milliseconds,
                          Timer::TimeOutCallback callback,
                          const ProcessorInstance& comp) {
-  comp->executeAsync([callback{move(callback)}, milliseconds]() mutable {
+  timeoutAfter(milliseconds, std::chrono::milliseconds{0}, move(callback),
+               comp);
+}
+
+void Timer::timeoutAfter(milliseconds interval, milliseconds slack,
+                         Timer::TimeOutCallback callback,
+                         const ProcessorInstance& comp) {
+  comp->executeAsync([callback{move(callback)}, interval, slack]() mutable {
     auto tm = make_shared<TimerData>();
-    runTimer(tm, milliseconds, move(callback));
+    runTimer(tm, interval, slack, move(callback));
   });
 }
 
-void TimerMgr::cleanup() {
-  records_.clear();
-  state_ = State::NoTimer;
+TimerMgr::~TimerMgr() {
+  wheel_.clear([](auto& node) {
+    auto& record = static_cast<TimerData&>(node);
+    record.owner = nullptr;
+    record.self.reset();
+  });
 }
 
-void TimerMgr::refresh() { make_heap(begin(), end(), timerGreater); }
-
-void TimerMgr::checkAllTimers() {
-  if (state_ == State::Waiting) {
-    return;
+size_t TimerMgr::expire() {
+  size_t expiredCount = 0;
+  if (wheel_.empty() || this_processor::stopped()) {
+    return expiredCount;
   }
-  auto comp = this_processor::instance();
-  while (auto timer = getShortestTimer()) {
-    if (!timer->expired()) {
-      state_ = State::Waiting;
-      comp->runOnceUntil(timer->deadline);
-      state_ = State::HaveTimer;
-    }
-
-    if (comp->stopped()) {
-      break;
-    }
-
-    if (!timer->expired()) {
-      continue;
-    }
-
-    state_ = State::HaveTimer;
-    // shortest timer might be stopped while waiting
-    if (timer->running) {
-      onShortestTimerExpired(timer);
+  // Expiries reached after a callback stopped the processor are kept for the
+  // next run of it, as pending executions of a reused processor would be
+  std::vector<TimerData*> deferred;
+  wheel_.advance(ticks_.now(), [this, &expiredCount, &deferred](auto& node) {
+    auto& record = static_cast<TimerData&>(node);
+    if (this_processor::stopped()) {
+      deferred.push_back(&record);
+    } else {
+      expiredCount += onExpired(record);
     }
+  });
+  for (auto record : deferred) {
+    wheel_.insert(*record, record->expiry);
   }
+  return expiredCount;
 }
 
-void TimerMgr::start(TimerDataPtr record) {
-  if (!record->running) {
-    record->running = true;
-    add(record);
-  } else {
-    refresh();
-  }
-  onTimerModified();
+ExecutionDeadline TimerMgr::nextDeadline() const {
+  return wheel_.empty() ? ExecutionDeadline::max()
+                        : ticks_.timeOf(wheel_.nextTick());
 }
 
-void TimerMgr::stop(TimerDataPtr record) {
-  if (record->running) {
-    record->running = false;
-    if (auto removedShortest = remove(record);
-        removedShortest && !records_.empty()) {
-      interruptCurrentTimer(this_processor::instance());
-    }
+void TimerMgr::start(const TimerDataPtr& record) {
+  assert(this_processor::instance() &&
+         "Timer must be triggered in thread of a mesasging::Processor");
+  if (record->owner && record->owner != this) {
+    MAF_LOGGER_WARN("Timer is running on another thread, stop it first");
+    return;
   }
+  unschedule(*record);
+  record->running = true;
+  record->self = record;
+  record->due = ticks_.tickOf(Clock::now() + record->duration);
+  schedule(*record);
 }
 
-void TimerMgr::onTimerModified() {
-  auto thisProcessorInstance = this_processor::instance();
-  assert(thisProcessorInstance &&
-         "Timer must be triggered in thread of a mesasging::Processor")
-      thisProcessorInstance->executeAsync([this] { this->checkAllTimers(); });
+void TimerMgr::stop(const TimerDataPtr& record) {
+  record->running = false;
+  // Record of another thread is dropped by that thread when it expires
+  if (record->owner == this) {
+    unschedule(*record);
+  }
 }
 
-void TimerMgr::onShortestTimerExpired(const TimerDataPtr& record) {
-  if (record->cyclic) {
-    updateShortestTimer();
-  } else {
-    record->running = false;
-    removeShortestTimer();
+void TimerMgr::restart(const TimerDataPtr& record) {
+  if (record->owner == this || !record->running) {
+    start(record);
   }
-  record->onExpired();
 }
 
-void TimerMgr::restart(const TimerDataPtr& r) {
-  r->restart();
-  if (r == records_.front()) {
-    pop_heap(begin(), end(), timerGreater);
-    push_heap(begin(), end(), timerGreater);
+bool TimerMgr::onExpired(TimerData& record) {
+  auto keepAlive = move(record.self);
+  record.owner = nullptr;
+  if (!record.running) {
+    return false;
+  }
+  if (record.cyclic) {
+    // Next period counts from when it was due, not from when it fired
+    record.due += details::TickClock::ticksOf(record.duration);
+    schedule(record);
+    record.self = move(keepAlive);
+    // Callback may destroy its own Timer
+    auto keepRecord = record.self;
+    record.onExpired();
   } else {
-    refresh();
+    record.running = false;
+    record.onExpired();
   }
-  onTimerModified();
+  return true;
 }
 
-void TimerMgr::add(TimerDataPtr newRecord) {
-  using namespace std;
-  records_.push_back(move(newRecord));
-  push_heap(begin(), end(), timerGreater);
+void TimerMgr::schedule(TimerData& record) {
+  record.owner = this;
+  auto slack = details::TickClock::ticksOf(record.slack);
+  wheel_.insert(record, coalescedTick(record.due, slack));
 }
 
-bool TimerMgr::remove(TimerDataPtr tm) {
-  auto removedShortestOne = false;
-  if (!records_.empty()) {
-    if (records_.front() == tm) {
-      removeShortestTimer();
-      removedShortestOne = true;
-    } else if (auto it = std::remove(begin(), end(), tm); it != end()) {
-      records_.erase(it);
-      if (!checkRecordListEmpty()) {
-        refresh();
-      }
-    }
+void TimerMgr::unschedule(TimerData& record) {
+  if (record.owner == this) {
+    wheel_.remove(record);
+    record.owner = nullptr;
+    record.self.reset();
   }
-  return removedShortestOne;
 }
 
-TimerDataPtr TimerMgr::getShortestTimer() {
-  if (!records_.empty()) {
-    return records_.front();
+// Picks the tick in [due, due + slack] with most trailing zero bits, timers
+// with overlapping windows tend to land on the same one
+uint64_t TimerMgr::coalescedTick(uint64_t due, uint64_t slack) const {
+  auto coalesced = due;
+  // Multiples of a bigger step are never earlier, stop at first one too late
+  for (uint64_t step = 2; slack > 0; step <<= 1) {
+    auto aligned = (due + step - 1) & ~(step - 1);
+    if (aligned > due + slack) {
+      break;
+    }
+    coalesced = aligned;
   }
-  return {};
+  return coalesced;
 }
 
-TimerDataPtr TimerMgr::removeShortestTimer() {
-  using namespace std;
-  pop_heap(begin(), end(), timerGreater);
-  auto tm = move(records_.back());
-  records_.pop_back();
-  checkRecordListEmpty();
-  return tm;
-}
+namespace details {
 
-void TimerMgr::updateShortestTimer() {
-  records_.front()->updateNextDeadline();
-  pop_heap(begin(), end(), timerGreater);
-  push_heap(begin(), end(), timerGreater);
-}
+size_t expireTimers() { return mgr().expire(); }
 
-void TimerMgr::interruptCurrentTimer(const ProcessorInstance& comp) {
-  if (state_ == State::Waiting && comp) {
-    comp->executeAsync([] {
-      // an empty callback just to wakeup runOnceUntil wait
-    });
-  }
-}
+ExecutionDeadline nextTimerDeadline() { return mgr().nextDeadline(); }
 
-bool TimerMgr::checkRecordListEmpty() {
-  if (records_.empty()) {
-    state_ = State::NoTimer;
-    return true;
-  }
-  return false;
-}
+}  // namespace details
 
 }  // namespace messaging
 }  // namespace maf
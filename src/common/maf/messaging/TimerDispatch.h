@@ -0,0 +1,19 @@
+#pragma once
+
+#include <maf/messaging/ProcessorDef.h>
+
+namespace maf {
+namespace messaging {
+namespace details {
+
+// Timers belong to the thread they are started on, the Processor running on
+// that thread dispatches them between batches of executions
+
+// Calls callbacks of the expired timers, returns how many were called
+size_t expireTimers();
+// ExecutionDeadline::max() if there's no running timer
+ExecutionDeadline nextTimerDeadline();
+
+}  // namespace details
+}  // namespace messaging
+}  // namespace maf
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <maf/patterns/Patterns.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace maf {
+namespace messaging {
+namespace details {
+
+// Intrusive link of a timer record, linking and unlinking never allocates
+struct TimingWheelNode {
+  TimingWheelNode *prev = nullptr;
+  TimingWheelNode *next = nullptr;
+  // In ticks of the wheel
+  uint64_t expiry = 0;
+  uint32_t slot = 0;
+
+  bool linked() const { return next != nullptr; }
+};
+
+// Hierarchical timing wheel: LevelCount levels of 64 slots, a slot of level k
+// spans 64^k ticks. Insert and remove are O(1), nodes of a higher level slot
+// are cascaded down when the wheel reaches it. Occupancy bitmaps let the
+// wheel jump over empty ticks, then idle time costs nothing.
+// Expiries further than the wheel span wait in the farthest slot and are
+// placed again when it is cascaded.
+class TimingWheel : public pattern::Unasignable {
+ public:
+  using Node = TimingWheelNode;
+  static constexpr unsigned SlotBits = 6;
+  static constexpr unsigned SlotCount = 1u << SlotBits;
+  static constexpr unsigned LevelCount = 5;
+  static constexpr uint64_t NoTick = UINT64_MAX;
+
+  TimingWheel() {
+    for (auto &head : slots_) {
+      head.prev = head.next = &head;
+    }
+  }
+
+  uint64_t now() const { return now_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Node expires at given tick, or at next tick if it is not in the future
+  void insert(Node &node, uint64_t expiry) {
+    node.expiry = std::max(expiry, now_ + 1);
+    place(node);
+    ++size_;
+  }
+
+  void remove(Node &node) {
+    if (node.linked()) {
+      unlink(node);
+      --size_;
+    }
+  }
+
+  // Next tick the wheel has something to do at, either expiring nodes or
+  // cascading them down
+  uint64_t nextTick() const {
+    auto next = NoTick;
+    for (unsigned level = 0; level < LevelCount; ++level) {
+      if (auto occupied = occupied_[level]) {
+        auto shift = SlotBits * level;
+        auto position = now_ >> shift;
+        auto start = static_cast<unsigned>((position + 1) & (SlotCount - 1));
+        // Bit i of rotated is slot start + i
+        auto rotated = start == 0 ? occupied
+                                  : (occupied >> start) |
+                                        (occupied << (SlotCount - start));
+        auto tick = (position + 1 + countTrailingZeros(rotated)) << shift;
+        next = std::min(next, tick);
+      }
+    }
+    return next;
+  }
+
+  // Moves the wheel up to tick, onExpired(node) is called for expired nodes
+  // in order of expiry. Nodes are unlinked before the call, then onExpired
+  // may insert them again or remove others.
+  template <class OnExpired>
+  void advance(uint64_t tick, OnExpired &&onExpired) {
+    while (!empty()) {
+      auto next = nextTick();
+      if (next > tick) {
+        break;
+      }
+      processTick(next, onExpired);
+    }
+    now_ = std::max(now_, tick);
+  }
+
+  // Unlinks every node then calls onRemoved(node) for it
+  template <class OnRemoved>
+  void clear(OnRemoved &&onRemoved) {
+    for (auto &head : slots_) {
+      while (head.next != &head) {
+        auto &node = *head.next;
+        remove(node);
+        onRemoved(node);
+      }
+    }
+  }
+
+ private:
+  static constexpr uint64_t spanOf(unsigned levels) {
+    return uint64_t{1} << (SlotBits * levels);
+  }
+
+  static unsigned countTrailingZeros(uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(bits));
+#endif
+  }
+
+  static uint64_t bitOf(uint32_t slot) {
+    return uint64_t{1} << (slot % SlotCount);
+  }
+
+  // Expiry must not be before now_
+  void place(Node &node) {
+    auto due = std::max(node.expiry, now_);
+    unsigned level = 0;
+    while (level + 1 < LevelCount && due - now_ >= spanOf(level + 1)) {
+      ++level;
+    }
+    if (due - now_ >= spanOf(LevelCount)) {
+      due = now_ + spanOf(LevelCount) - 1;
+    }
+    auto index = (due >> (SlotBits * level)) & (SlotCount - 1);
+    link(node, static_cast<uint32_t>(level * SlotCount + index));
+  }
+
+  void link(Node &node, uint32_t slot) {
+    auto &head = slots_[slot];
+    node.slot = slot;
+    node.prev = head.prev;
+    node.next = &head;
+    head.prev->next = &node;
+    head.prev = &node;
+    occupied_[slot / SlotCount] |= bitOf(slot);
+  }
+
+  void unlink(Node &node) {
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.prev = node.next = nullptr;
+    auto &head = slots_[node.slot];
+    if (head.next == &head) {
+      occupied_[node.slot / SlotCount] &= ~bitOf(node.slot);
+    }
+  }
+
+  // Moves nodes of a slot to a list of their own, so that the slot can be
+  // filled again while they are handled
+  void detach(uint32_t slot, Node &list) {
+    auto &head = slots_[slot];
+    if (head.next == &head) {
+      list.prev = list.next = &list;
+      return;
+    }
+    list.next = head.next;
+    list.prev = head.prev;
+    list.next->prev = list.prev->next = &list;
+    head.prev = head.next = &head;
+    occupied_[slot / SlotCount] &= ~bitOf(slot);
+  }
+
+  template <class OnExpired>
+  void processTick(uint64_t tick, OnExpired &onExpired) {
+    now_ = tick;
+    for (unsigned level = 1; level < LevelCount; ++level) {
+      if (tick % spanOf(level) != 0) {
+        break;
+      }
+      auto index = (tick >> (SlotBits * level)) & (SlotCount - 1);
+      Node cascaded;
+      detach(static_cast<uint32_t>(level * SlotCount + index), cascaded);
+      while (cascaded.next != &cascaded) {
+        auto &node = *cascaded.next;
+        node.prev->next = node.next;
+        node.next->prev = node.prev;
+        place(node);
+      }
+    }
+
+    Node expired;
+    detach(static_cast<uint32_t>(tick & (SlotCount - 1)), expired);
+    while (expired.next != &expired) {
+      auto &node = *expired.next;
+      node.prev->next = node.next;
+      node.next->prev = node.prev;
+      node.prev = node.next = nullptr;
+      --size_;
+      onExpired(node);
+    }
+  }
+
+  std::array<Node, LevelCount * SlotCount> slots_;
+  std::array<uint64_t, LevelCount> occupied_ = {};
+  uint64_t now_ = 0;
+  size_t size_ = 0;
+};
+
+// Millisecond ticks of a timing wheel, counted from when the clock is made.
+// A timer due at tickOf(time) never expires before time.
+class TickClock {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using Tick = std::chrono::milliseconds;
+
+  uint64_t now() const {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<Tick>(Clock::now() - origin_).count());
+  }
+
+  // First tick that is not before given time
+  uint64_t tickOf(Clock::time_point time) const {
+    return static_cast<uint64_t>(
+        std::chrono::ceil<Tick>(time - origin_).count());
+  }
+
+  Clock::time_point timeOf(uint64_t tick) const { return origin_ + Tick{tick}; }
+
+  template <class Rep, class Period>
+  static uint64_t ticksOf(std::chrono::duration<Rep, Period> duration) {
+    return static_cast<uint64_t>(
+        std::max<Tick::rep>(std::chrono::ceil<Tick>(duration).count(), 0));
+  }
+
+ private:
+  const Clock::time_point origin_ = Clock::now();
+};
+
+}  // namespace details
+}  // namespace messaging
+}  // namespace maf
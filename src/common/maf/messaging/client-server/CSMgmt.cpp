@@ -3,7 +3,8 @@
 
 #include "ClientFactory.h"
 #include "ServerFactory.h"
-#include "SingleThreadPool.h"
+#include "ipc/LocalIPCServer.h"
+#include "IncomingDispatcher.h"
 
 namespace maf {
 namespace messaging {
@@ -53,6 +54,14 @@ void shutdownAll() {
 
 void shutdownAllServers() { serverFactory()->close(); }
 
+bool setIncomingMessageThreadCount(size_t count) {
+  return incoming_dispatcher::setWorkerCount(count);
+}
+
+bool setBroadcastWriterThreadCount(size_t count) {
+  return ipc::local::setBroadcastWriterCount(count);
+}
+
 }  // namespace csmgmt
 }  // namespace messaging
 }  // namespace maf
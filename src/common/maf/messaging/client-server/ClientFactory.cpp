@@ -2,10 +2,12 @@
 
 #include <maf/logging/Logger.h>
 #include <maf/messaging/client-server/ipc/local/ConnectionType.h>
+#include <maf/messaging/client-server/ipc/shm/ConnectionType.h>
 #include <maf/messaging/client-server/itc/ConnectionType.h>
 #include <maf/utils/containers/Map2D.h>
 
 #include "ipc/LocalIPCClient.h"
+#include "ipc/ShmIPCClient.h"
 #include "itc/Client.h"
 
 namespace maf {
@@ -25,6 +27,8 @@ class ClientFactoryImpl {
       return itc::makeClient();
     } else if (connectionType == ipc::local::connection_type) {
       return ipc::local::makeClient();
+    } else if (connectionType == ipc::shm::connection_type) {
+      return ipc::shm::makeClient();
     } else {
       MAF_LOGGER_ERROR("Request creating with non-exist connection type [",
                        connectionType, "]");
@@ -0,0 +1,84 @@
+#include "IncomingDispatcher.h"
+
+#include <maf/messaging/ProcessorEx.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace maf {
+namespace messaging {
+namespace incoming_dispatcher {
+
+static constexpr size_t MAX_DEFAULT_WORKER_COUNT = 8;
+
+// Each worker is a processor, then handlers can use timers and other
+// processor facilities as they did on the former single thread
+class Workers {
+ public:
+  explicit Workers(size_t count) : processors_(count) {
+    for (auto &processor : processors_) {
+      std::thread{[instance = processor.instance()] { instance->run(); }}
+          .detach();
+    }
+  }
+
+  bool submit(ShardKey key, TaskType task) {
+    return processors_[key % processors_.size()]->executeAsync(
+        std::move(task));
+  }
+
+  size_t count() const { return processors_.size(); }
+
+ private:
+  std::vector<ProcessorExBase> processors_;
+};
+
+// Worker count set by user, 0 for the default one. Taken once when workers
+// are started, then it is left as Started for late setters to fail on
+static constexpr size_t Started = SIZE_MAX;
+static std::atomic_size_t configuredWorkerCount = 0;
+
+static Workers &workers() {
+  static Workers *_ = [] {
+    auto count = configuredWorkerCount.exchange(Started);
+    if (count == 0) {
+      count = std::clamp<size_t>(std::thread::hardware_concurrency(), 1,
+                                 MAX_DEFAULT_WORKER_COUNT);
+    }
+    return new Workers{count};
+  }();
+  return *_;
+}
+
+bool submit(ShardKey key, TaskType task) {
+  return workers().submit(key, std::move(task));
+}
+
+ShardKey keyOf(const Address &peer) {
+  auto key = std::hash<Address::Name>{}(peer.get_name());
+  key ^= std::hash<Address::Port>{}(peer.get_port()) + 0x9e3779b9 +
+         (key << 6) + (key >> 2);
+  return key;
+}
+
+bool setWorkerCount(size_t count) {
+  if (count == 0 || count == Started) {
+    return false;
+  }
+  auto current = configuredWorkerCount.load();
+  do {
+    if (current == Started) {
+      return false;
+    }
+  } while (!configuredWorkerCount.compare_exchange_weak(current, count));
+  return true;
+}
+
+size_t workerCount() { return workers().count(); }
+
+}  // namespace incoming_dispatcher
+}  // namespace messaging
+}  // namespace maf
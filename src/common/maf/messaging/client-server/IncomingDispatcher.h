@@ -0,0 +1,28 @@
+#pragma once
+
+#include <maf/messaging/client-server/Address.h>
+
+#include <functional>
+
+namespace maf {
+namespace messaging {
+namespace incoming_dispatcher {
+
+using TaskType = std::function<void()>;
+using ShardKey = size_t;
+
+// Tasks submitted with same key run one after another in submission order,
+// tasks of different keys may run in parallel on other worker threads
+bool submit(ShardKey key, TaskType task);
+
+// Every frame of one peer, messages and status changes alike, must keep its
+// order then shares the key of that peer
+ShardKey keyOf(const Address &peer);
+
+// Takes effect only before the first submit, returns false if too late
+bool setWorkerCount(size_t count);
+size_t workerCount();
+
+}  // namespace incoming_dispatcher
+}  // namespace messaging
+}  // namespace maf
@@ -2,10 +2,12 @@
 
 #include <maf/logging/Logger.h>
 #include <maf/messaging/client-server/ipc/local/ConnectionType.h>
+#include <maf/messaging/client-server/ipc/shm/ConnectionType.h>
 #include <maf/messaging/client-server/itc/ConnectionType.h>
 #include <maf/utils/containers/Map2D.h>
 
 #include "ipc/LocalIPCServer.h"
+#include "ipc/ShmIPCServer.h"
 #include "itc/Server.h"
 
 namespace maf {
@@ -24,6 +26,8 @@ class ServerFactoryImpl {
       return itc::makeServer();
     } else if (connectionType == ipc::local::connection_type) {
       return ipc::local::makeServer();
+    } else if (connectionType == ipc::shm::connection_type) {
+      return ipc::shm::makeServer();
     } else {
       MAF_LOGGER_ERROR("Request creating with non-exist connection type [",
                        connectionType, "]");
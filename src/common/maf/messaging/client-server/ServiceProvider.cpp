@@ -155,15 +155,22 @@ ActionCallStatus ServiceProvider::broadcastToClients(
                                  RequestIDInvalid, payload);
 
     auto trySendToDestinations =
-        [this, &csMsg](AddressList &addresses) -> AddressList {
+        [this, &csMsg](const AddressList &addresses) -> AddressList {
       AddressList busyReceivers;
-      for (const auto &addr : addresses) {
-        auto errCode = sendMessage(csMsg, addr);
+      // Message is encoded once then the same bytes go to every client
+      auto server = server_.lock();
+      auto errCodes = server ? server->sendMessageToClients(csMsg, addresses)
+                             : std::vector<ActionCallStatus>(
+                                   addresses.size(),
+                                   ActionCallStatus::ReceiverUnavailable);
+      for (size_t i = 0; i < addresses.size(); ++i) {
+        const auto &addr = addresses[i];
+        auto errCode = errCodes[i];
         if (errCode == ActionCallStatus::Success) {
           MAF_LOGGER_INFO("Sent message id: ", csMsg->operationID(),
                           " from server side!");
         } else if (errCode == ActionCallStatus::ReceiverBusy) {
-          busyReceivers.emplace_back(std::move(addr));
+          busyReceivers.push_back(addr);
         } else {
           this->removeRegistersOfAddress(addr);
           MAF_LOGGER_WARN(
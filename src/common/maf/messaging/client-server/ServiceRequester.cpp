@@ -247,12 +247,13 @@ void ServiceRequester::onServiceStatusChanged(const ServiceID &sid,
   MAF_LOGGER_INFO("Server status change from ", oldStatus, " to ", newStatus);
   if ((sid == serviceID()) && (newStatus != serviceStatus_)) {
     serviceStatus_ = newStatus;
+    // Observers learn about the change before pending requests are broken,
+    // then a caller woken up by a broken request sees the new status
+    forwardServiceStatusToObservers(sid, oldStatus, newStatus);
     if (newStatus == Availability::Unavailable) {
-      serviceStatus_ = Availability::Unavailable;
       clearAllRequests();
       clearAllRegisterEntries();
     }
-    forwardServiceStatusToObservers(sid, oldStatus, newStatus);
   }
 }
 
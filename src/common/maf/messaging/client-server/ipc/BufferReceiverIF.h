@@ -1,6 +1,7 @@
 #pragma once
 
 #include <maf/messaging/client-server/Address.h>
+#include <maf/messaging/client-server/CSStatus.h>
 #include <maf/utils/serialization/Buffer.h>
 
 namespace maf {
@@ -23,6 +24,12 @@ public:
   virtual bool running() const = 0;
   virtual const Address &address() const = 0;
   virtual void setObserver(BytesComeObserver *observer) = 0;
+  // Sends bytes back on the connection that peer opened to this receiver,
+  // ReceiverUnavailable if there's no such connection
+  virtual ActionCallStatus sendBack(const srz::Buffer & /*bytes*/,
+                                    const Address & /*peer*/) {
+    return ActionCallStatus::ReceiverUnavailable;
+  }
 };
 
 } // namespace ipc
@@ -34,6 +34,11 @@ void LocalIPCBufferReceiver::setObserver(BytesComeObserver *observer) {
       [observer](auto &&bytes) { observer->onBytesCome(std::move(bytes)); });
 }
 
+ActionCallStatus LocalIPCBufferReceiver::sendBack(const srz::Buffer &bytes,
+                                                  const Address &peer) {
+  return _impl->sendBack(bytes, peer);
+}
+
 }  // namespace local
 }  // namespace ipc
 }  // namespace messaging
@@ -19,6 +19,8 @@ class LocalIPCBufferReceiver : public BufferReceiverIF {
   void deinit() override;
   const Address &address() const override;
   void setObserver(BytesComeObserver *observer) override;
+  ActionCallStatus sendBack(const srz::Buffer &bytes,
+                            const Address &peer) override;
 
  private:
   std::unique_ptr<class LocalIPCBufferReceiverImpl> _impl;
@@ -9,12 +9,11 @@
 #include <thread>
 
 #include "../ClientBase.h"
-#include "../SingleThreadPool.h"
+#include "../IncomingDispatcher.h"
 #include "BufferReceiverIF.h"
 #include "BufferSenderIF.h"
 #include "IPCTypes.h"
-#include "LocalIPCBufferReceiver.h"
-#include "LocalIPCBufferSender.h"
+#include "LocalIPCClientConnection.h"
 #include "LocalIPCMessage.h"
 
 namespace maf {
@@ -24,7 +23,8 @@ namespace local {
 
 class LocalIPCClient : public ClientBase, public BytesComeObserver {
  public:
-  LocalIPCClient();
+  LocalIPCClient(std::shared_ptr<BufferSenderIF> sender,
+                 std::shared_ptr<BufferReceiverIF> receiver);
   ~LocalIPCClient() override;
 
   bool init(const Address &serverAddress) override;
@@ -46,16 +46,17 @@ class LocalIPCClient : public ClientBase, public BytesComeObserver {
   Timer serverMonitorTimer_;
   std::thread receiverThread_;
 
-  std::unique_ptr<BufferSenderIF> pSender_;
-  std::unique_ptr<BufferReceiverIF> pReceiver_;
+  // might be the two sides of one connection
+  std::shared_ptr<BufferSenderIF> pSender_;
+  std::shared_ptr<BufferReceiverIF> pReceiver_;
 
   Availability currentServerStatus_ = Availability::Unavailable;
   int serverMonitorInterval = 500;
 };
 
-LocalIPCClient::LocalIPCClient()
-    : pSender_{new local::LocalIPCBufferSender},
-      pReceiver_{new LocalIPCBufferReceiver} {}
+LocalIPCClient::LocalIPCClient(std::shared_ptr<BufferSenderIF> sender,
+                               std::shared_ptr<BufferReceiverIF> receiver)
+    : pSender_{std::move(sender)}, pReceiver_{std::move(receiver)} {}
 
 bool LocalIPCClient::init(const Address &serverAddress) {
   assert(serverAddress.valid());
@@ -73,7 +74,10 @@ bool LocalIPCClient::init(const Address &serverAddress) {
 
 bool LocalIPCClient::start() {
   receiverThread_ = std::thread{[this] { pReceiver_->start(); }};
-  single_threadpool::submit([this] { monitorServerStatus(); });
+  // Status changes of server are handled on the shard of its messages, then
+  // they never overtake each other
+  incoming_dispatcher::submit(incoming_dispatcher::keyOf(myServerAddress_),
+                              [this] { monitorServerStatus(); });
   return true;
 }
 
@@ -135,25 +139,38 @@ void LocalIPCClient::monitorServerStatus(long long tunedInterval) {
   } else if (tunedInterval < serverMonitorInterval) {
     tunedInterval += 5;
   }
-  serverMonitorTimer_.start(tunedInterval, [tunedInterval, this] {
+  // Polling doesn't need to be precise, let it share wakeups with others
+  auto interval = std::chrono::milliseconds{tunedInterval};
+  serverMonitorTimer_.start(interval, interval / 4, [tunedInterval, this] {
     this->monitorServerStatus(tunedInterval);
   });
 }
 
 void LocalIPCClient::onBytesCome(srz::Buffer &&buff) {
-  single_threadpool::submit([this, buff = std::move(buff)]() mutable {
-    std::shared_ptr<LocalIPCMessage> csMsg =
-        std::make_shared<LocalIPCMessage>();
-    if (csMsg->fromBytes(std::move(buff))) {
-      onIncomingMessage(csMsg);
-    } else {
-      MAF_LOGGER_ERROR("incoming message is not wellformed");
-    }
-  });
+  // Only the header is decoded here, payload is translated later by the
+  // handler on the worker thread
+  auto csMsg = std::make_shared<LocalIPCMessage>();
+  if (!csMsg->fromBytes(std::move(buff))) {
+    MAF_LOGGER_ERROR("incoming message is not wellformed");
+    return;
+  }
+
+  incoming_dispatcher::submit(
+      incoming_dispatcher::keyOf(myServerAddress_),
+      [this, csMsg = std::move(csMsg)] { onIncomingMessage(csMsg); });
 }
 
 std::shared_ptr<ClientIF> makeClient() {
-  return std::make_shared<LocalIPCClient>();
+  // Requests and responses share one connection, then server doesn't need to
+  // connect back to the client
+  auto connection = std::make_shared<LocalIPCClientConnection>();
+  return makeClient(connection, connection);
+}
+
+std::shared_ptr<ClientIF> makeClient(std::shared_ptr<BufferSenderIF> sender,
+                                     std::shared_ptr<BufferReceiverIF> receiver) {
+  return std::make_shared<LocalIPCClient>(std::move(sender),
+                                          std::move(receiver));
 }
 
 }  // namespace local
@@ -6,9 +6,15 @@ namespace maf {
 namespace messaging {
 class ClientIF;
 namespace ipc {
+
+class BufferSenderIF;
+class BufferReceiverIF;
+
 namespace local {
 
 std::shared_ptr<ClientIF> makeClient();
+std::shared_ptr<ClientIF> makeClient(std::shared_ptr<BufferSenderIF> sender,
+                                     std::shared_ptr<BufferReceiverIF> receiver);
 
 }  // namespace local
 }  // namespace ipc
@@ -0,0 +1,50 @@
+#include "LocalIPCClientConnection.h"
+
+#include <maf/messaging/client-server/ipc/LocalIPCClientConnectionImpl.h>
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace local {
+
+LocalIPCClientConnection::LocalIPCClientConnection() {
+  _impl = std::make_unique<LocalIPCClientConnectionImpl>();
+}
+
+LocalIPCClientConnection::~LocalIPCClientConnection() {}
+
+ActionCallStatus LocalIPCClientConnection::send(const srz::Buffer &ba,
+                                                const Address &destination) {
+  return _impl->send(ba, destination);
+}
+
+Availability LocalIPCClientConnection::checkReceiverStatus(
+    const Address &destination) const {
+  return _impl->checkReceiverStatus(destination);
+}
+
+bool LocalIPCClientConnection::init(const Address &address) {
+  return _impl->init(address);
+}
+
+bool LocalIPCClientConnection::start() { return _impl->start(); }
+
+void LocalIPCClientConnection::stop() { _impl->stop(); }
+
+bool LocalIPCClientConnection::running() const { return _impl->running(); }
+
+void LocalIPCClientConnection::deinit() { _impl->deinit(); }
+
+const Address &LocalIPCClientConnection::address() const {
+  return _impl->address();
+}
+
+void LocalIPCClientConnection::setObserver(BytesComeObserver *observer) {
+  _impl->setObserver(
+      [observer](auto &&bytes) { observer->onBytesCome(std::move(bytes)); });
+}
+
+}  // namespace local
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <memory>
+
+#include "BufferReceiverIF.h"
+#include "BufferSenderIF.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace local {
+
+// Sends to server and receives from it over one long-lived connection
+class LocalIPCClientConnection : public BufferSenderIF,
+                                 public BufferReceiverIF {
+ public:
+  LocalIPCClientConnection();
+  ~LocalIPCClientConnection() override;
+
+  ActionCallStatus send(const maf::srz::Buffer &ba,
+                        const Address &destination) override;
+  Availability checkReceiverStatus(const Address &destination) const override;
+
+  bool init(const Address &address) override;
+  bool start() override;
+  bool running() const override;
+  void stop() override;
+  void deinit() override;
+  const Address &address() const override;
+  void setObserver(BytesComeObserver *observer) override;
+
+ private:
+  std::unique_ptr<class LocalIPCClientConnectionImpl> _impl;
+};
+
+}  // namespace local
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -2,10 +2,14 @@
 
 #include <maf/logging/Logger.h>
 #include <maf/messaging/client-server/ServiceProviderIF.h>
+#include <maf/threading/ThreadPoolFactory.h>
 
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <mutex>
 
-#include "../SingleThreadPool.h"
+#include "../IncomingDispatcher.h"
 #include "LocalIPCBufferReceiver.h"
 #include "LocalIPCBufferSender.h"
 #include "LocalIPCMessage.h"
@@ -15,12 +19,84 @@ namespace messaging {
 namespace ipc {
 namespace local {
 
+namespace {
+
+std::atomic_size_t defaultBroadcastWriterCount = 0;
+
+// Pending writes of one broadcast. A write arrives once its task is done
+// with, run or dropped by the pool, then the broadcasting thread never waits
+// for a task that won't come.
+struct Broadcast {
+  std::shared_ptr<const srz::Buffer> bytes;
+  std::vector<ActionCallStatus> results;
+  std::mutex mutex;
+  std::condition_variable allWritten;
+  size_t remaining = 0;
+
+  void arrive() {
+    {
+      std::lock_guard lock(mutex);
+      --remaining;
+    }
+    allWritten.notify_one();
+  }
+
+  void waitAll() {
+    std::unique_lock lock(mutex);
+    allWritten.wait(lock, [this] { return remaining == 0; });
+  }
+};
+
+// Held by a write task, arrives when the task is destroyed
+class BroadcastArrival {
+ public:
+  explicit BroadcastArrival(std::shared_ptr<Broadcast> broadcast)
+      : broadcast_{std::move(broadcast)} {}
+  BroadcastArrival(BroadcastArrival &&) noexcept = default;
+  BroadcastArrival &operator=(BroadcastArrival &&) = delete;
+  ~BroadcastArrival() {
+    if (broadcast_) {
+      broadcast_->arrive();
+    }
+  }
+  Broadcast *operator->() const { return broadcast_.get(); }
+
+ private:
+  std::shared_ptr<Broadcast> broadcast_;
+};
+
+threading::ExecutorPoolPtr createBroadcastWriters(size_t count) {
+  if (count == 0) {
+    return {};
+  }
+  return threading::ThreadPoolFactory::createExecutorPool(
+      static_cast<unsigned int>(count));
+}
+
+}  // namespace
+
+bool setBroadcastWriterCount(size_t count) {
+  defaultBroadcastWriterCount = count;
+  return true;
+}
+
 LocalIPCServer::LocalIPCServer()
-    : pSender_{new LocalIPCBufferSender},
-      pReceiver_{new LocalIPCBufferReceiver} {}
+    : LocalIPCServer{std::make_unique<LocalIPCBufferSender>(),
+                     std::make_unique<LocalIPCBufferReceiver>()} {}
+
+LocalIPCServer::LocalIPCServer(std::unique_ptr<BufferSenderIF> sender,
+                               std::unique_ptr<BufferReceiverIF> receiver)
+    : pSender_{std::move(sender)},
+      pReceiver_{std::move(receiver)},
+      broadcastWriters_{
+          createBroadcastWriters(defaultBroadcastWriterCount.load())} {}
 
 LocalIPCServer::~LocalIPCServer() = default;
 
+void LocalIPCServer::setBroadcastWriterCount(size_t count) {
+  broadcastWriters_ = createBroadcastWriters(count);
+}
+
 bool LocalIPCServer::init(const Address &serverAddress) {
   if (pReceiver_->init(serverAddress)) {
     pReceiver_->setObserver(this);
@@ -46,20 +122,69 @@ void LocalIPCServer::stop() {
 ActionCallStatus LocalIPCServer::sendMessageToClient(const CSMessagePtr &msg,
                                                      const Address &addr) {
   assert(msg != nullptr);
-  if (pSender_) {
-    try {
-      return pSender_->send(
-          std::static_pointer_cast<LocalIPCMessage>(msg)->toBytes(), addr);
-    } catch (const std::bad_alloc &e) {
-      MAF_LOGGER_ERROR("Message is too large to be serialized: ", e.what());
-      return ActionCallStatus::FailedUnknown;
+  try {
+    return sendBytesToClient(
+        std::static_pointer_cast<LocalIPCMessage>(msg)->toBytes(), addr);
+  } catch (const std::bad_alloc &e) {
+    MAF_LOGGER_ERROR("Message is too large to be serialized: ", e.what());
+    return ActionCallStatus::FailedUnknown;
+  }
+}
+
+std::vector<ActionCallStatus> LocalIPCServer::sendMessageToClients(
+    const CSMessagePtr &msg, const std::vector<Address> &addrs) {
+  assert(msg != nullptr);
+  std::vector<ActionCallStatus> results(addrs.size(),
+                                        ActionCallStatus::FailedUnknown);
+  std::shared_ptr<const srz::Buffer> bytes;
+  try {
+    bytes = std::make_shared<const srz::Buffer>(
+        std::static_pointer_cast<LocalIPCMessage>(msg)->toBytes());
+  } catch (const std::bad_alloc &e) {
+    MAF_LOGGER_ERROR("Message is too large to be serialized: ", e.what());
+    return results;
+  }
+
+  if (!broadcastWriters_ || addrs.size() < 2) {
+    for (size_t i = 0; i < addrs.size(); ++i) {
+      results[i] = sendBytesToClient(*bytes, addrs[i]);
     }
-  } else {
+    return results;
+  }
+
+  // A slow client only delays returning from here, not the writes to other
+  // clients
+  auto broadcast = std::make_shared<Broadcast>();
+  broadcast->bytes = std::move(bytes);
+  broadcast->results = std::move(results);
+  broadcast->remaining = addrs.size() - 1;
+  for (size_t i = 1; i < addrs.size(); ++i) {
+    broadcastWriters_->enqueue(
+        [this, i, addr = addrs[i],
+         arrival = BroadcastArrival{broadcast}]() mutable {
+          arrival->results[i] = sendBytesToClient(*arrival->bytes, addr);
+        });
+  }
+  broadcast->results[0] = sendBytesToClient(*broadcast->bytes, addrs[0]);
+  broadcast->waitAll();
+  return std::move(broadcast->results);
+}
+
+ActionCallStatus LocalIPCServer::sendBytesToClient(const srz::Buffer &bytes,
+                                                   const Address &addr) {
+  if (!pSender_) {
     MAF_LOGGER_ERROR(
         "Cannot send message due to null sender, please call init "
         "function before send function");
     return ActionCallStatus::ReceiverUnavailable;
   }
+  // Prefer the connection client keeps open to us, connect to client's
+  // own receiver only if it doesn't have one
+  if (auto status = pReceiver_->sendBack(bytes, addr);
+      status != ActionCallStatus::ReceiverUnavailable) {
+    return status;
+  }
+  return pSender_->send(bytes, addr);
 }
 
 void LocalIPCServer::notifyServiceStatusToClient(const ServiceID &sid,
@@ -136,18 +261,22 @@ bool LocalIPCServer::onIncomingMessage(const CSMessagePtr &csMsg) {
 }
 
 void LocalIPCServer::onBytesCome(srz::Buffer &&buff) {
-  single_threadpool::submit([thisw = weak_from_this(),
-                             buff = std::move(buff)]() mutable {
-    if (auto this_ = thisw.lock()) {
-      std::shared_ptr<LocalIPCMessage> csMsg =
-          std::make_shared<LocalIPCMessage>();
-      if (csMsg->fromBytes(std::move(buff))) {
-        static_cast<LocalIPCServer *>(this_.get())->onIncomingMessage(csMsg);
-      } else {
-        MAF_LOGGER_ERROR("incoming message is not wellformed");
-      }
-    }
-  });
+  // Only the header is decoded here, payload is translated later by the
+  // handler on the worker thread
+  auto csMsg = std::make_shared<LocalIPCMessage>();
+  if (!csMsg->fromBytes(std::move(buff))) {
+    MAF_LOGGER_ERROR("incoming message is not wellformed");
+    return;
+  }
+
+  // Key must be taken before csMsg is moved into the task
+  auto key = incoming_dispatcher::keyOf(csMsg->sourceAddress());
+  incoming_dispatcher::submit(
+      key, [thisw = weak_from_this(), csMsg = std::move(csMsg)] {
+        if (auto this_ = thisw.lock()) {
+          static_cast<LocalIPCServer *>(this_.get())->onIncomingMessage(csMsg);
+        }
+      });
 }
 
 void LocalIPCServer::notifyServiceStatusToClient(const Address &clAddr,
@@ -175,6 +304,12 @@ std::shared_ptr<ServerIF> makeServer() {
   return std::make_shared<LocalIPCServer>();
 }
 
+std::shared_ptr<ServerIF> makeServer(std::unique_ptr<BufferSenderIF> sender,
+                                     std::unique_ptr<BufferReceiverIF> receiver) {
+  return std::make_shared<LocalIPCServer>(std::move(sender),
+                                          std::move(receiver));
+}
+
 }  // namespace local
 }  // namespace ipc
 }  // namespace messaging
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <maf/threading/ExecutorPool.h>
+
 #include <set>
 #include <thread>
 
@@ -19,6 +21,8 @@ namespace local {
 class LocalIPCServer : public ServerBase, public BytesComeObserver {
  public:
   LocalIPCServer();
+  LocalIPCServer(std::unique_ptr<BufferSenderIF> sender,
+                 std::unique_ptr<BufferReceiverIF> receiver);
   ~LocalIPCServer() override;
   bool init(const Address &serverAddress) override;
   bool start() override;
@@ -26,12 +30,19 @@ class LocalIPCServer : public ServerBase, public BytesComeObserver {
 
   ActionCallStatus sendMessageToClient(const CSMessagePtr &msg,
                                        const Address &addr) override;
+  std::vector<ActionCallStatus> sendMessageToClients(
+      const CSMessagePtr &msg, const std::vector<Address> &addrs) override;
   void notifyServiceStatusToClient(const ServiceID &sid, Availability oldStatus,
                                    Availability newStatus) override;
   bool onIncomingMessage(const CSMessagePtr &csMsg) override;
+  // Number of threads writing a broadcast to clients in parallel, 0 to write
+  // on the broadcasting thread. Must be set before the server is started.
+  void setBroadcastWriterCount(size_t count);
 
  protected:
   void onBytesCome(srz::Buffer &&buff) override;
+  ActionCallStatus sendBytesToClient(const srz::Buffer &bytes,
+                                     const Address &addr);
   void notifyServiceStatusToClient(const Address &clAddr, const ServiceID &sid,
                                    Availability oldStatus,
                                    Availability newStatus);
@@ -40,9 +51,16 @@ class LocalIPCServer : public ServerBase, public BytesComeObserver {
   std::unique_ptr<BufferSenderIF> pSender_;
   std::unique_ptr<BufferReceiverIF> pReceiver_;
   std::thread listeningThread_;
+  threading::ExecutorPoolPtr broadcastWriters_;
 };
 
+// Broadcast writer count of servers created afterwards, see
+// LocalIPCServer::setBroadcastWriterCount
+bool setBroadcastWriterCount(size_t count);
+
 std::shared_ptr<ServerIF> makeServer();
+std::shared_ptr<ServerIF> makeServer(std::unique_ptr<BufferSenderIF> sender,
+                                     std::unique_ptr<BufferReceiverIF> receiver);
 
 }  // namespace local
 }  // namespace ipc
@@ -0,0 +1,40 @@
+#include "ShmIPCBufferReceiver.h"
+
+#include <maf/messaging/client-server/ipc/ShmIPCBufferReceiverImpl.h>
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+ShmIPCBufferReceiver::ShmIPCBufferReceiver() {
+  _impl = std::make_unique<ShmIPCBufferReceiverImpl>();
+}
+
+ShmIPCBufferReceiver::~ShmIPCBufferReceiver() {}
+
+bool ShmIPCBufferReceiver::init(const Address &address) {
+  return _impl->init(address);
+}
+
+bool ShmIPCBufferReceiver::start() { return _impl->start(); }
+
+void ShmIPCBufferReceiver::stop() { _impl->stop(); }
+
+bool ShmIPCBufferReceiver::running() const { return _impl->running(); }
+
+void ShmIPCBufferReceiver::deinit() { _impl->deinit(); }
+
+const Address &ShmIPCBufferReceiver::address() const {
+  return _impl->address();
+}
+
+void ShmIPCBufferReceiver::setObserver(BytesComeObserver *observer) {
+  _impl->setObserver(
+      [observer](auto &&bytes) { observer->onBytesCome(std::move(bytes)); });
+}
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
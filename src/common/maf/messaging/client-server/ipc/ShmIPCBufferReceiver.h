@@ -0,0 +1,29 @@
+#pragma once
+
+#include "BufferReceiverIF.h"
+#include <memory>
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+class ShmIPCBufferReceiver : public BufferReceiverIF {
+ public:
+  ShmIPCBufferReceiver();
+  ~ShmIPCBufferReceiver() override;
+  bool init(const Address &address) override;
+  bool start() override;
+  bool running() const override;
+  void stop() override;
+  void deinit() override;
+  const Address &address() const override;
+  void setObserver(BytesComeObserver *observer) override;
+
+ private:
+  std::unique_ptr<class ShmIPCBufferReceiverImpl> _impl;
+};
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
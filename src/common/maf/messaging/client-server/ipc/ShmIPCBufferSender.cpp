@@ -0,0 +1,29 @@
+#include "ShmIPCBufferSender.h"
+
+#include <maf/messaging/client-server/ipc/ShmIPCBufferSenderImpl.h>
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+ShmIPCBufferSender::ShmIPCBufferSender() {
+  _pImpl = std::make_unique<ShmIPCBufferSenderImpl>();
+}
+
+ShmIPCBufferSender::~ShmIPCBufferSender() {}
+
+ActionCallStatus ShmIPCBufferSender::send(const srz::Buffer &ba,
+                                          const Address &destination) {
+  return _pImpl->send(ba, destination);
+}
+
+Availability ShmIPCBufferSender::checkReceiverStatus(
+    const Address &destination) const {
+  return _pImpl->checkReceiverStatus(destination);
+}
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
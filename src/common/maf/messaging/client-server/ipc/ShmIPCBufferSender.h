@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+
+#include "BufferSenderIF.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+class ShmIPCBufferSender : public maf::messaging::ipc::BufferSenderIF {
+ public:
+  ShmIPCBufferSender();
+  ~ShmIPCBufferSender() override;
+  ActionCallStatus send(const maf::srz::Buffer &ba,
+                        const Address &destination) override;
+  Availability checkReceiverStatus(const Address &destination) const override;
+
+ private:
+  std::unique_ptr<class ShmIPCBufferSenderImpl> _pImpl;
+};
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -0,0 +1,21 @@
+#include "ShmIPCClient.h"
+
+#include "LocalIPCClient.h"
+#include "ShmIPCBufferReceiver.h"
+#include "ShmIPCBufferSender.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+// Same protocol as local ipc client, only bytes travel on shared memory
+std::shared_ptr<ClientIF> makeClient() {
+  return local::makeClient(std::make_unique<ShmIPCBufferSender>(),
+                           std::make_unique<ShmIPCBufferReceiver>());
+}
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <memory>
+
+namespace maf {
+namespace messaging {
+class ClientIF;
+namespace ipc {
+namespace shm {
+
+std::shared_ptr<ClientIF> makeClient();
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
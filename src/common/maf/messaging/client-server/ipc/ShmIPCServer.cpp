@@ -0,0 +1,21 @@
+#include "ShmIPCServer.h"
+
+#include "LocalIPCServer.h"
+#include "ShmIPCBufferReceiver.h"
+#include "ShmIPCBufferSender.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+// Same protocol as local ipc server, only bytes travel on shared memory
+std::shared_ptr<ServerIF> makeServer() {
+  return local::makeServer(std::make_unique<ShmIPCBufferSender>(),
+                           std::make_unique<ShmIPCBufferReceiver>());
+}
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
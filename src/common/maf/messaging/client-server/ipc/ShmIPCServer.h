@@ -0,0 +1,16 @@
+#pragma once
+
+#include <memory>
+
+namespace maf {
+namespace messaging {
+class ServerIF;
+namespace ipc {
+namespace shm {
+
+std::shared_ptr<ServerIF> makeServer();
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -1,32 +1,285 @@
 #include "DynamicCountThreadPool.h"
+#include <maf/logging/Logger.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
 
 namespace maf {
 namespace threading {
 
-VaryCountThreadPool::VaryCountThreadPool(unsigned int nThreadCount)
-    : _impl{nThreadCount, &threading::run, &threading::stop, &threading::done} {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct QueuedRunner {
+  Runnable *runner;
+  Clock::time_point queuedAt;
+};
+
+struct Worker {
+  std::thread thread;
+  // Guarded by the pool mutex, so that shutdown can stop it
+  Runnable *running = nullptr;
+};
+
+unsigned int effectiveMax(unsigned int nThreadCount) {
+  return nThreadCount != 0 ? nThreadCount
+                           : std::max(std::thread::hardware_concurrency(), 1u);
 }
 
+} // namespace
+
+struct ElasticPoolImpl {
+  std::mutex mutex;
+  std::condition_variable hasWork;
+  // Wakes the monitor up when queued tasks may need one more thread
+  std::condition_variable queueChanged;
+  std::deque<QueuedRunner> queue;
+  // std::list keeps a worker at the same address when it moves to retired
+  std::list<Worker> workers;
+  // Exited workers, joined by the next one that spawns or by shutdown
+  std::list<Worker> retired;
+  unsigned int idleCount = 0;
+  // Spawned threads that have not taken a task yet, counted as idle
+  unsigned int startingCount = 0;
+  unsigned int minCount;
+  unsigned int maxCount;
+  Clock::duration spawnLatency;
+  Clock::duration idleTimeout;
+  bool stopping = false;
+  // Spawns a thread once the oldest queued task has waited spawnLatency,
+  // even if no task is queued or taken meanwhile. Not needed without latency:
+  // a thread is spawned as soon as a task is queued then.
+  std::thread monitor;
+
+  explicit ElasticPoolImpl(const ElasticPoolOptions &options)
+      : maxCount{effectiveMax(options.maxThreadCount)},
+        spawnLatency{options.spawnLatency}, idleTimeout{options.idleTimeout} {
+    minCount = std::min(options.minThreadCount, maxCount);
+    std::list<Worker> none;
+    std::lock_guard lock(mutex);
+    while (workers.size() < minCount && spawn(none)) {
+    }
+    if (spawnLatency > Clock::duration::zero()) {
+      try {
+        monitor = std::thread{&ElasticPoolImpl::watch, this};
+      } catch (const std::system_error &err) {
+        MAF_LOGGER_WARN("Cannot launch new thread due to: ", err.what());
+      }
+    }
+  }
+
+  // Mutex must be held. Returns false if no thread could be launched.
+  bool spawn(std::list<Worker> &exited) {
+    exited.splice(exited.end(), retired);
+    auto worker = workers.emplace(workers.end());
+    try {
+      worker->thread = std::thread{&ElasticPoolImpl::work, this, &*worker};
+      ++startingCount;
+      return true;
+    } catch (const std::system_error &err) {
+      workers.erase(worker);
+      MAF_LOGGER_WARN("Cannot launch new thread due to: ", err.what());
+      return false;
+    }
+  }
+
+  // Mutex must be held
+  bool needsMoreThreads() const {
+    if (idleCount + startingCount > 0 || workers.size() >= maxCount ||
+        queue.empty()) {
+      return false;
+    }
+    // Queued work is never left without a thread
+    return workers.size() < std::max(minCount, 1u) ||
+           Clock::now() - queue.front().queuedAt >= spawnLatency;
+  }
+
+  void work(Worker *self) {
+    std::unique_lock lock(mutex);
+    --startingCount;
+    while (!stopping) {
+      if (!queue.empty()) {
+        auto runner = queue.front().runner;
+        queue.pop_front();
+        self->running = runner;
+        std::list<Worker> exited;
+        if (needsMoreThreads()) {
+          spawn(exited);
+        } else if (!queue.empty()) {
+          // The next one may need a thread later
+          queueChanged.notify_one();
+        }
+        lock.unlock();
+        join(exited);
+        threading::run(runner);
+        lock.lock();
+        self->running = nullptr;
+        lock.unlock();
+        threading::done(runner);
+        lock.lock();
+        continue;
+      }
+      if (workers.size() > maxCount) {
+        break;
+      }
+      ++idleCount;
+      auto woken = hasWork.wait_for(lock, idleTimeout, [this] {
+        return stopping || !queue.empty() || workers.size() > maxCount;
+      });
+      --idleCount;
+      if (!woken && workers.size() > minCount) {
+        break;
+      }
+    }
+    if (!stopping) {
+      retire(self);
+    }
+  }
+
+  void watch() {
+    std::unique_lock lock(mutex);
+    while (!stopping) {
+      std::list<Worker> exited;
+      auto late = needsMoreThreads();
+      if (late && spawn(exited)) {
+        lock.unlock();
+        join(exited);
+        lock.lock();
+        continue;
+      }
+      // Thread could not be launched, wait for the queue to change
+      if (late || queue.empty() || idleCount + startingCount > 0 ||
+          workers.size() >= maxCount) {
+        queueChanged.wait(lock);
+      } else {
+        queueChanged.wait_until(lock, queue.front().queuedAt + spawnLatency);
+      }
+    }
+  }
+
+  // Mutex must be held, self is not used by the pool afterward
+  void retire(Worker *self) {
+    for (auto it = workers.begin(); it != workers.end(); ++it) {
+      if (&*it == self) {
+        retired.splice(retired.end(), workers, it);
+        break;
+      }
+    }
+  }
+
+  static void join(std::list<Worker> &exited) {
+    for (auto &worker : exited) {
+      if (worker.thread.joinable()) {
+        worker.thread.join();
+      }
+    }
+  }
+
+  void run(Runnable *runner) {
+    std::list<Worker> exited;
+    {
+      std::lock_guard lock(mutex);
+      if (!stopping) {
+        queue.push_back({runner, Clock::now()});
+        if (idleCount > 0) {
+          hasWork.notify_one();
+        } else if (needsMoreThreads()) {
+          spawn(exited);
+        } else {
+          queueChanged.notify_one();
+        }
+        runner = nullptr;
+      }
+    }
+    join(exited);
+    // Pool is shut down
+    threading::done(runner);
+  }
+
+  void shutdown() {
+    std::list<Worker> all;
+    std::deque<QueuedRunner> pending;
+    {
+      std::lock_guard lock(mutex);
+      if (stopping) {
+        return;
+      }
+      stopping = true;
+      for (auto &worker : workers) {
+        threading::stop(worker.running);
+      }
+      pending.swap(queue);
+      all.splice(all.end(), workers);
+      all.splice(all.end(), retired);
+    }
+    hasWork.notify_all();
+    queueChanged.notify_all();
+    if (monitor.joinable()) {
+      monitor.join();
+    }
+    for (auto &queued : pending) {
+      threading::done(queued.runner);
+    }
+    join(all);
+  }
+};
+
+VaryCountThreadPool::VaryCountThreadPool(unsigned int nThreadCount)
+    : VaryCountThreadPool(ElasticPoolOptions{0, nThreadCount}) {}
+
+VaryCountThreadPool::VaryCountThreadPool(const ElasticPoolOptions &options)
+    : _pImpl{std::make_unique<ElasticPoolImpl>(options)} {}
+
 void VaryCountThreadPool::run(Runnable *pRuner, unsigned int /*priority*/) {
   if (pRuner) {
-    if (_impl.activeThreadCount() < _impl.maxThreadCount()) {
-      _impl.tryLaunchNewThread();
-    }
-    _impl.run(pRuner);
+    _pImpl->run(pRuner);
   }
 }
 
 void VaryCountThreadPool::setMaxThreadCount(unsigned int nThreadCount) {
-  _impl.setMaxThreadCount(nThreadCount);
+  std::lock_guard lock(_pImpl->mutex);
+  _pImpl->maxCount = effectiveMax(nThreadCount);
+  _pImpl->minCount = std::min(_pImpl->minCount, _pImpl->maxCount);
+  // Idle threads above the new max exit
+  _pImpl->hasWork.notify_all();
+  _pImpl->queueChanged.notify_one();
+}
+
+void VaryCountThreadPool::setMinThreadCount(unsigned int nThreadCount) {
+  std::list<Worker> exited;
+  {
+    std::lock_guard lock(_pImpl->mutex);
+    _pImpl->minCount = nThreadCount;
+    _pImpl->maxCount = std::max(_pImpl->maxCount, nThreadCount);
+    while (!_pImpl->stopping && _pImpl->workers.size() < nThreadCount &&
+           _pImpl->spawn(exited)) {
+    }
+  }
+  ElasticPoolImpl::join(exited);
 }
 
 unsigned int VaryCountThreadPool::activeThreadCount() {
-  return _impl.activeThreadCount();
+  std::lock_guard lock(_pImpl->mutex);
+  return static_cast<unsigned int>(_pImpl->workers.size());
+}
+
+unsigned int VaryCountThreadPool::minThreadCount() {
+  std::lock_guard lock(_pImpl->mutex);
+  return _pImpl->minCount;
+}
+
+unsigned int VaryCountThreadPool::maxThreadCount() {
+  std::lock_guard lock(_pImpl->mutex);
+  return _pImpl->maxCount;
 }
 
-void VaryCountThreadPool::shutdown() { _impl.shutdown(); }
+void VaryCountThreadPool::shutdown() { _pImpl->shutdown(); }
 
-VaryCountThreadPool::~VaryCountThreadPool() {}
+VaryCountThreadPool::~VaryCountThreadPool() { shutdown(); }
 
 } // namespace threading
 } // namespace maf
@@ -1,22 +1,27 @@
 #pragma once
 
-#include <maf/threading/IThreadPool.h>
-#include <maf/threading/Queue.h>
-#include <maf/threading/ThreadPoolImplBase.h>
+#include <maf/threading/IElasticThreadPool.h>
+#include <memory>
 
 namespace maf {
 namespace threading {
-class VaryCountThreadPool : public IThreadPool {
+
+class VaryCountThreadPool : public IElasticThreadPool {
 public:
   VaryCountThreadPool(unsigned int nThreadCount = 0);
+  VaryCountThreadPool(const ElasticPoolOptions &options);
   virtual void run(Runnable *pRuner, unsigned int priority = 0) override;
   virtual void setMaxThreadCount(unsigned int nThreadCount) override;
   virtual unsigned int activeThreadCount() override;
   virtual void shutdown() override;
+  void setMinThreadCount(unsigned int nThreadCount) override;
+  unsigned int minThreadCount() override;
+  unsigned int maxThreadCount() override;
   ~VaryCountThreadPool() override;
 
 private:
-  ThreadPoolImplBase<Queue<Runnable *>> _impl;
+  std::unique_ptr<struct ElasticPoolImpl> _pImpl;
 };
+
 } // namespace threading
 } // namespace maf
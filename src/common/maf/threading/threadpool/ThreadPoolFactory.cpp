@@ -1,6 +1,7 @@
 #include "DynamicCountThreadPool.h"
 #include "PriorityThreadPool.h"
 #include "StableThreadPool.h"
+#include "WorkStealingThreadPool.h"
 #include <maf/threading/ThreadPoolFactory.h>
 
 namespace maf {
@@ -19,9 +20,21 @@ ThreadPoolFactory::createPool(PoolType type, unsigned int poolSize) {
   case DynamicCount:
     pPool.reset(new VaryCountThreadPool(poolSize));
     break;
+  case WorkStealing:
+    pPool.reset(new WorkStealingThreadPool(poolSize));
+    break;
   }
   return pPool;
 }
 
+std::shared_ptr<IElasticThreadPool>
+ThreadPoolFactory::createElasticPool(const ElasticPoolOptions &options) {
+  return std::make_shared<VaryCountThreadPool>(options);
+}
+
+ExecutorPoolPtr ThreadPoolFactory::createExecutorPool(unsigned int poolSize) {
+  return std::make_shared<WorkStealingThreadPool>(poolSize);
+}
+
 } // namespace threading
 } // namespace maf
@@ -0,0 +1,255 @@
+#include "WorkStealingThreadPool.h"
+
+#include <maf/logging/Logger.h>
+#include <maf/threading/Task.h>
+#include <maf/threading/ThreadPoolImplBase.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace maf {
+namespace threading {
+
+namespace {
+
+// Gives a Runnable back to its owner even if it is dropped without running
+class RunnableJob {
+public:
+  explicit RunnableJob(Runnable *runner) : _runner{runner} {}
+  RunnableJob(RunnableJob &&other) noexcept : _runner{other._runner} {
+    other._runner = nullptr;
+  }
+  RunnableJob &operator=(RunnableJob &&) = delete;
+  ~RunnableJob() { done(_runner); }
+
+  Runnable *runner() const { return _runner; }
+
+private:
+  Runnable *_runner;
+};
+
+struct Job {
+  Task task;
+  // Set for jobs given by IThreadPool::run, so that shutdown can stop them
+  Runnable *runner = nullptr;
+};
+
+struct Worker {
+  // Guards jobs only, thieves take it
+  std::mutex mutex;
+  std::deque<Job> jobs;
+  // Runnable being run, so that shutdown can stop it
+  RunningSlot<Runnable> running;
+  std::thread thread;
+};
+
+} // namespace
+
+struct WorkStealingPoolImpl {
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic_size_t pending = 0;
+  std::atomic_size_t sleepers = 0;
+  std::atomic_size_t nextWorker = 0;
+  std::atomic_bool stopping = false;
+  std::mutex sleepMutex;
+  std::condition_variable wakeUp;
+  std::once_flag shutdowned;
+
+  static thread_local Worker *currentWorker;
+  static thread_local WorkStealingPoolImpl *currentPool;
+
+  explicit WorkStealingPoolImpl(unsigned int threadCount) {
+    if (threadCount == 0) {
+      threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    for (unsigned int i = 0; i < threadCount; ++i) {
+      workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+      try {
+        workers[i]->thread = std::thread{&WorkStealingPoolImpl::work, this, i};
+      } catch (const std::system_error &err) {
+        MAF_LOGGER_WARN("Cannot launch new thread due to: ", err.what());
+      }
+    }
+  }
+
+  // Stopping is checked under the deque lock, then shutdown, which drains
+  // the deques under it too, never leaves a job behind.
+  // Jobs are counted while the lock is held, then a worker that takes one
+  // never sees fewer pending jobs than there are in the deques.
+  bool submit(Job job) {
+    auto &worker = target();
+    {
+      std::lock_guard lock(worker.mutex);
+      if (stopping.load(std::memory_order_relaxed)) {
+        return false;
+      }
+      worker.jobs.push_back(std::move(job));
+      pending.fetch_add(1);
+    }
+    wakeUpSleepers(1);
+    return true;
+  }
+
+  bool submitBulk(std::vector<Task> tasks) {
+    auto &worker = target();
+    {
+      std::lock_guard lock(worker.mutex);
+      if (stopping.load(std::memory_order_relaxed)) {
+        return false;
+      }
+      for (auto &task : tasks) {
+        worker.jobs.push_back(Job{std::move(task)});
+      }
+      pending.fetch_add(tasks.size());
+    }
+    if (!tasks.empty()) {
+      wakeUpSleepers(tasks.size());
+    }
+    return true;
+  }
+
+  Worker &target() {
+    if (currentPool == this) {
+      return *currentWorker;
+    }
+    auto index = nextWorker.fetch_add(1, std::memory_order_relaxed);
+    return *workers[index % workers.size()];
+  }
+
+  void wakeUpSleepers(size_t jobCount) {
+    if (sleepers.load() > 0) {
+      std::lock_guard lock(sleepMutex);
+      if (jobCount > 1) {
+        wakeUp.notify_all();
+      } else {
+        wakeUp.notify_one();
+      }
+    }
+  }
+
+  void work(size_t index) {
+    currentPool = this;
+    currentWorker = workers[index].get();
+    while (!stopping.load(std::memory_order_acquire)) {
+      Job job;
+      if (popLocal(index, job) || steal(index, job)) {
+        pending.fetch_sub(1, std::memory_order_relaxed);
+        runJob(*workers[index], job);
+        continue;
+      }
+      std::unique_lock lock(sleepMutex);
+      sleepers.fetch_add(1);
+      wakeUp.wait(lock, [this] { return stopping || pending.load() > 0; });
+      sleepers.fetch_sub(1);
+    }
+  }
+
+  bool popLocal(size_t index, Job &job) {
+    auto &worker = *workers[index];
+    std::lock_guard lock(worker.mutex);
+    if (worker.jobs.empty()) {
+      return false;
+    }
+    job = std::move(worker.jobs.back());
+    worker.jobs.pop_back();
+    return true;
+  }
+
+  bool steal(size_t thief, Job &job) {
+    for (size_t i = 1; i < workers.size(); ++i) {
+      auto &victim = *workers[(thief + i) % workers.size()];
+      std::lock_guard lock(victim.mutex);
+      if (!victim.jobs.empty()) {
+        job = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void runJob(Worker &worker, Job &job) {
+    if (job.runner) {
+      worker.running.enter(*job.runner);
+    }
+    job.task();
+    if (job.runner) {
+      worker.running.leave(*job.runner);
+    }
+    // Destroys the job before the next one is taken
+    job.task = nullptr;
+  }
+
+  void shutdown() {
+    {
+      std::lock_guard lock(sleepMutex);
+      stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto &worker : workers) {
+      worker->running.stop([](Runnable &runner) { runner.stop(); });
+    }
+    // Nothing is pushed after this. Dropped jobs are destroyed on return,
+    // with no lock held, as that runs continuations of their promises.
+    std::vector<std::deque<Job>> dropped(workers.size());
+    for (size_t i = 0; i < workers.size(); ++i) {
+      std::lock_guard lock(workers[i]->mutex);
+      dropped[i].swap(workers[i]->jobs);
+    }
+    for (auto &worker : workers) {
+      if (worker->thread.joinable()) {
+        worker->thread.join();
+      }
+    }
+  }
+};
+
+thread_local Worker *WorkStealingPoolImpl::currentWorker = nullptr;
+thread_local WorkStealingPoolImpl *WorkStealingPoolImpl::currentPool = nullptr;
+
+WorkStealingThreadPool::WorkStealingThreadPool(unsigned int threadCount)
+    : _pImpl{std::make_unique<WorkStealingPoolImpl>(threadCount)} {}
+
+WorkStealingThreadPool::~WorkStealingThreadPool() { shutdown(); }
+
+void WorkStealingThreadPool::run(Runnable *pRuner, unsigned int /*priority*/) {
+  if (pRuner) {
+    auto job = RunnableJob{pRuner};
+    _pImpl->submit(Job{[job = std::move(job)] { threading::run(job.runner()); },
+                       pRuner});
+  }
+}
+
+unsigned int WorkStealingThreadPool::activeThreadCount() {
+  return threadCount();
+}
+
+void WorkStealingThreadPool::shutdown() {
+  std::call_once(_pImpl->shutdowned, &WorkStealingPoolImpl::shutdown,
+                 _pImpl.get());
+}
+
+bool WorkStealingThreadPool::execute(CallbackType callback) noexcept {
+  return callback && _pImpl->submit(Job{std::move(callback)});
+}
+
+bool WorkStealingThreadPool::enqueue(Task task) {
+  return task && _pImpl->submit(Job{std::move(task)});
+}
+
+bool WorkStealingThreadPool::enqueueBulk(std::vector<Task> tasks) {
+  return _pImpl->submitBulk(std::move(tasks));
+}
+
+unsigned int WorkStealingThreadPool::threadCount() const {
+  return static_cast<unsigned int>(_pImpl->workers.size());
+}
+
+} // namespace threading
+} // namespace maf
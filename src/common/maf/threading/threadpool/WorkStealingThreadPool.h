@@ -0,0 +1,38 @@
+#pragma once
+
+#include <maf/threading/ExecutorPool.h>
+#include <maf/threading/IThreadPool.h>
+#include <maf/utils/ExecutorIF.h>
+
+#include <memory>
+
+namespace maf {
+namespace threading {
+
+// Every worker owns a deque: it pops its own work LIFO, while idle workers
+// steal FIFO from the others, then workers only contend when stealing.
+// Work submitted from a worker goes to its own deque, other threads spread
+// it round robin. Pending work is dropped on shutdown, like other pools do.
+class WorkStealingThreadPool : public IThreadPool,
+                               public ExecutorPool,
+                               public util::ExecutorIF {
+public:
+  WorkStealingThreadPool(unsigned int threadCount = 0);
+  ~WorkStealingThreadPool() override;
+  virtual void run(Runnable *pRuner, unsigned int priority = 0) override;
+  // Worker count is fixed at construction
+  virtual void setMaxThreadCount(unsigned int /*nThreadCount*/) override {}
+  virtual unsigned int activeThreadCount() override;
+  virtual void shutdown() override;
+  bool execute(CallbackType callback) noexcept override;
+  bool enqueue(Task task) override;
+  // Tasks go to one deque, the other workers steal them from there
+  bool enqueueBulk(std::vector<Task> tasks) override;
+  unsigned int threadCount() const override;
+
+private:
+  std::unique_ptr<struct WorkStealingPoolImpl> _pImpl;
+};
+
+} // namespace threading
+} // namespace maf
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <maf/utils/serialization/Buffer.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "SocketShared.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+
+// Rebuilds length-prefixed frames [SizeType length][payload] from a byte
+// stream that may deliver them in arbitrary pieces.
+// onFrame(payload, control) is called for every completed frame, control
+// tells the frame was sent with CONTROL_FRAME_FLAG.
+class FrameAssembler {
+ public:
+  template <class FrameCallback>
+  void feed(const char *data, size_t length, FrameCallback &&onFrame) {
+    constexpr auto HeaderSize = sizeof(SizeType);
+    while (length > 0) {
+      size_t consumed = 0;
+      if (headerRead_ < HeaderSize) {
+        consumed = std::min(length, HeaderSize - headerRead_);
+        memcpy(reinterpret_cast<char *>(&payloadLength_) + headerRead_, data,
+               consumed);
+        headerRead_ += consumed;
+        if (headerRead_ == HeaderSize) {
+          control_ = (payloadLength_ & CONTROL_FRAME_FLAG) != 0;
+          payloadLength_ &= ~CONTROL_FRAME_FLAG;
+          payload_.resize(payloadLength_);
+          payloadRead_ = 0;
+        }
+      } else {
+        consumed = std::min(length, payloadLength_ - payloadRead_);
+        memcpy(payload_.data() + payloadRead_, data, consumed);
+        payloadRead_ += consumed;
+      }
+
+      data += consumed;
+      length -= consumed;
+
+      if (headerRead_ == HeaderSize && payloadRead_ == payloadLength_) {
+        headerRead_ = 0;
+        onFrame(std::move(payload_), control_);
+        payload_ = {};
+      }
+    }
+  }
+
+ private:
+  SizeType payloadLength_ = 0;
+  size_t headerRead_ = 0;
+  size_t payloadRead_ = 0;
+  bool control_ = false;
+  srz::Buffer payload_;
+};
+
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
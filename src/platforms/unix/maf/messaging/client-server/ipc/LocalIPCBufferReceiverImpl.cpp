@@ -1,9 +1,13 @@
 #include "LocalIPCBufferReceiverImpl.h"
 
 #include <arpa/inet.h>
+#include <fcntl.h>
 #include <maf/logging/Logger.h>
+#include <maf/utils/CallOnExit.h>
 #include <netinet/in.h>
 #include <stdlib.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/stat.h>
 
 #include "SocketShared.h"
@@ -13,6 +17,17 @@ namespace messaging {
 namespace ipc {
 namespace local {
 
+static constexpr int MAX_EVENTS_PER_WAIT = 64;
+static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+
+static bool addToEpoll(FD epollFD, FD fd, uint32_t events) {
+  epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.fd = fd;
+  return epoll_ctl(epollFD, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
 LocalIPCBufferReceiverImpl::~LocalIPCBufferReceiverImpl() { stop(); }
 
 bool LocalIPCBufferReceiverImpl::init(const Address &addr) {
@@ -24,16 +39,17 @@ bool LocalIPCBufferReceiverImpl::init(const Address &addr) {
     setState(State::Initialized);
     // Create the socket.
     int opt = true;
-    fdMySock_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    fdMySock_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (fdMySock_ != INVALID_FD &&
         (setsockopt(fdMySock_, SOL_SOCKET, SO_REUSEADDR,
                     reinterpret_cast<char *>(&opt), sizeof(opt)) >= 0)) {
       if (bind(fdMySock_, _2sockAddr(&mySockAddr_), sizeof(mySockAddr_)) >= 0) {
-        // Max 5 pending connections
-        if (listen(fdMySock_, 5) == 0) {
-          MAF_LOGGER_INFO("Listening on address ", myaddr_.dump());
-          setState(State::Initialized);
-          startable = true;
+        if (listen(fdMySock_, SOMAXCONN) == 0) {
+          if (initEventLoop()) {
+            MAF_LOGGER_INFO("Listening on address ", myaddr_.dump());
+            setState(State::Initialized);
+            startable = true;
+          }
         } else {
           MAF_LOGGER_ERROR("Could not listen on socket");
         }
@@ -46,9 +62,34 @@ bool LocalIPCBufferReceiverImpl::init(const Address &addr) {
   return startable;
 }
 
+bool LocalIPCBufferReceiverImpl::initEventLoop() {
+  if (fdEpoll_ = epoll_create1(EPOLL_CLOEXEC); fdEpoll_ == INVALID_FD) {
+    MAF_SOCKET_ERROR("Could not create epoll instance");
+    return false;
+  }
+  if (fdWakeup_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      fdWakeup_ == INVALID_FD) {
+    MAF_SOCKET_ERROR("Could not create eventfd for waking up receiver");
+    return false;
+  }
+  fdSpare_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  // Wakeup event is level triggered to never miss a stop request that comes
+  // before the loop starts waiting
+  if (!addToEpoll(fdEpoll_, fdWakeup_, EPOLLIN) ||
+      !addToEpoll(fdEpoll_, fdMySock_, EPOLLIN | EPOLLET)) {
+    MAF_SOCKET_ERROR("Could not register fds to epoll instance");
+    return false;
+  }
+  return true;
+}
+
 bool LocalIPCBufferReceiverImpl::start() {
   try {
-    if (getState() == State::Initialized) {
+    // A stopped receiver keeps its socket, then it can be started again
+    if (auto state = getState();
+        state == State::Initialized || state == State::Stopped) {
+      // A stop request of a previous run must not end this one
+      drainWakeup();
       setState(State::Running);
       waitAndProcessConnections();
     } else {
@@ -63,15 +104,21 @@ bool LocalIPCBufferReceiverImpl::start() {
 
 void LocalIPCBufferReceiverImpl::stop() {
   if (running()) {
-    auto currentState = getState();
     setState(State::Stopped);
-    // trying connect to socket to wake the running thread
-    if (currentState == State::WaitingConnection) {
-      connectToSocket(myaddr_.get_name());
+    // wake the running thread up
+    uint64_t one = 1;
+    if (write(fdWakeup_, &one, sizeof(one)) != sizeof(one)) {
+      MAF_SOCKET_ERROR("Could not wake up receiver at ", myaddr_.dump());
     }
   }
 }
 
+void LocalIPCBufferReceiverImpl::drainWakeup() {
+  uint64_t count = 0;
+  while (read(fdWakeup_, &count, sizeof(count)) == -1 && errno == EINTR) {
+  }
+}
+
 void LocalIPCBufferReceiverImpl::deinit() {}
 
 bool LocalIPCBufferReceiverImpl::running() const {
@@ -90,97 +137,232 @@ void LocalIPCBufferReceiverImpl::setObserver(BytesComeCallback callback) {
   bytesComeCallback_ = std::move(callback);
 }
 
-bool LocalIPCBufferReceiverImpl::waitAndProcessConnections() {
-  auto maxSd = INVALID_FD;
-  socklen_t sockLen = sizeof(mySockAddr_);
-  std::vector<int> fdClientSocks(MAXCLIENTS, 0);
-  fd_set readfds;
-  do {
-    // clear the socket set
-    FD_ZERO(&readfds);
+ActionCallStatus LocalIPCBufferReceiverImpl::sendBack(
+    const srz::Buffer &payload, const Address &peerAddr) {
+  PeerPtr peer;
+  {
+    std::lock_guard lock(peers_);
+    if (auto it = peers_->find(peerAddr.get_name()); it != peers_->end()) {
+      peer = it->second;
+    }
+  }
+  if (!peer) {
+    return ActionCallStatus::ReceiverUnavailable;
+  }
 
-    // add master socket to set
-    FD_SET(fdMySock_, &readfds);
-    maxSd = fdMySock_;
+  auto deadline = std::chrono::steady_clock::now() + SEND_TIMEOUT;
+  std::unique_lock lock(peer->mutex);
+  if (!peer->writerDone.wait_until(
+          lock, deadline, [&peer] { return !peer->writing; })) {
+    MAF_LOGGER_WARN("Timed out waiting for other writers to ",
+                    peerAddr.dump());
+    return ActionCallStatus::Timeout;
+  }
+  if (peer->dropped) {
+    return ActionCallStatus::ReceiverUnavailable;
+  }
+  peer->writing = true;
+  lock.unlock();
 
-    // add child sockets to set
-    for (size_t i = 0; i < MAXCLIENTS; i++) {
-      // socket descriptor
-      auto sd = fdClientSocks[i];
+  auto sent = sendFrame(peer->fd, payload, 0,
+                        std::chrono::duration_cast<std::chrono::milliseconds>(
+                            deadline - std::chrono::steady_clock::now()));
+  auto err = errno;
+  auto status = ActionCallStatus::Success;
+  if (!sent) {
+    if (isBrokenConnectionError(err)) {
+      // Peer is gone, receiver thread will clean the connection up
+      status = ActionCallStatus::ReceiverUnavailable;
+    } else {
+      MAF_LOGGER_ERROR("Failed to send payload of ", payload.length(),
+                       " bytes back to ", peerAddr.dump(), " with errno = ",
+                       err, "!");
+      status = err == ETIMEDOUT ? ActionCallStatus::Timeout
+                                : ActionCallStatus::FailedUnknown;
+    }
+    // A frame might have been written partly, then nothing more can go on
+    // the connection. Receiver thread sees the hangup and closes it
+    shutdown(peer->fd, SHUT_RDWR);
+  }
 
-      // if valid socket descriptor then add to read list
-      if (sd > 0) FD_SET(sd, &readfds);
+  lock.lock();
+  peer->writing = false;
+  peer->dropped = peer->dropped || !sent;
+  lock.unlock();
+  peer->writerDone.notify_all();
+  return status;
+}
 
-      // highest file descriptor number, need it for the select function
-      if (sd > maxSd) maxSd = sd;
-    }
+bool LocalIPCBufferReceiverImpl::waitAndProcessConnections() {
+  epoll_event events[MAX_EVENTS_PER_WAIT];
+  readBuffer_.resize(READ_CHUNK_SIZE);
 
-    timeval timeout = {1, 0};
+  util::CallOnExit closeClientSocks = [this] { closeAllConnections(); };
 
+  do {
     changeCurrentStateAndInterruptIfStop(State::Running,
                                          State::WaitingConnection);
 
-    auto totalSD = select(maxSd + 1, &readfds, nullptr, nullptr, &timeout);
+    auto totalEvents = epoll_wait(fdEpoll_, events, MAX_EVENTS_PER_WAIT, -1);
 
     changeCurrentStateAndInterruptIfStop(State::WaitingConnection,
                                          State::Running);
 
-    if (totalSD <= 0) {
+    if (totalEvents < 0) {
+      if (errno != EINTR) {
+        MAF_SOCKET_ERROR("Failed on waiting for socket events");
+        return false;
+      }
       continue;
     }
 
-    // If something happened on the master socket ,
-    // then its an incoming connection
-    if (FD_ISSET(fdMySock_, &readfds)) {
-      auto acceptedSD = accept(fdMySock_, _2sockAddr(&mySockAddr_), &sockLen);
-      if (acceptedSD < 0) {
-        MAF_LOGGER_ERROR("Failed on accepting new socket connection");
-        return false;
+    for (int i = 0; i < totalEvents; ++i) {
+      auto sd = events[i].data.fd;
+      if (sd == fdMySock_) {
+        acceptConnections();
+      } else if (sd == fdWakeup_) {
+        // Level triggered, it would fire on every wait until it is read
+        drainWakeup();
+      } else {
+        // Read even on hangup, the sender might have written its last frames
+        // before closing the connection
+        if ((events[i].events & EPOLLERR) || !readFrames(sd)) {
+          closeConnection(sd);
+        }
       }
+    }
+  } while (true);
+
+  setState(State::Stopped);
+  return true;
+}
 
-      // add new socket to array of sockets
-      for (size_t i = 0; i < MAXCLIENTS; i++) {
-        // if position is empty
-        if (fdClientSocks[i] == 0) {
-          fdClientSocks[i] = acceptedSD;
-          break;
+void LocalIPCBufferReceiverImpl::acceptConnections() {
+  // Edge triggered, then must accept until there's no pending connection
+  while (true) {
+    auto acceptedSD =
+        accept4(fdMySock_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (acceptedSD == INVALID_FD) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      // Edge triggered listener is not notified again for connections left
+      // in its backlog, then they are closed instead
+      if (errno == EMFILE || errno == ENFILE) {
+        if (rejectConnection()) {
+          continue;
         }
+        break;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        MAF_SOCKET_ERROR("Failed on accepting new socket connection");
       }
+      break;
+    }
+
+    // The connection is kept open for later messages from same sender
+    if (addToEpoll(fdEpoll_, acceptedSD, EPOLLIN | EPOLLRDHUP | EPOLLET)) {
+      auto peer = std::make_shared<Peer>();
+      peer->fd = acceptedSD;
+      clientConnections_.emplace(acceptedSD,
+                                 ClientConnection{std::move(peer), {}, {}});
+    } else {
+      MAF_SOCKET_ERROR("Rejected new connection to ", myaddr_.dump(),
+                       ", could not register it to epoll instance");
+      close(acceptedSD);
     }
+  }
+}
+
+bool LocalIPCBufferReceiverImpl::rejectConnection() {
+  MAF_SOCKET_ERROR("Rejected new connection to ", myaddr_.dump(),
+                   ", out of file descriptors with ",
+                   clientConnections_.size(), " connections open");
+  if (fdSpare_ == INVALID_FD) {
+    return false;
+  }
+  fdSpare_.reset();
+  auto acceptedSD = accept4(fdMySock_, nullptr, nullptr, SOCK_CLOEXEC);
+  if (acceptedSD != INVALID_FD) {
+    close(acceptedSD);
+  }
+  fdSpare_ = open("/dev/null", O_RDONLY | O_CLOEXEC);
+  return acceptedSD != INVALID_FD;
+}
+
+void LocalIPCBufferReceiverImpl::closeConnection(SockFD sd) {
+  auto itConnection = clientConnections_.find(sd);
+  if (itConnection == clientConnections_.end()) {
+    return;
+  }
+
+  auto &connection = itConnection->second;
+  if (!connection.peerName.empty()) {
+    std::lock_guard lock(peers_);
+    if (auto it = peers_->find(connection.peerName);
+        it != peers_->end() && it->second == connection.peer) {
+      peers_->erase(it);
+    }
+  }
+  epoll_ctl(fdEpoll_, EPOLL_CTL_DEL, sd, nullptr);
+  // Writers still holding the peer fail fast, fd is closed by the last one
+  shutdown(sd, SHUT_RDWR);
+  clientConnections_.erase(itConnection);
+}
+
+void LocalIPCBufferReceiverImpl::closeAllConnections() {
+  peers_.atomic()->clear();
+  for (auto &[sd, _] : clientConnections_) {
+    shutdown(sd, SHUT_RDWR);
+  }
+  clientConnections_.clear();
+}
 
-    // else its some IO operation on some other socket
-    for (size_t i = 0; i < MAXCLIENTS; i++) {
-      auto sd = fdClientSocks[i];
-      if (FD_ISSET(sd, &readfds)) {
-        SizeType messageLength = 0;
-        ssize_t totalRead = 0;
-        if (auto bytesRead = read(sd, reinterpret_cast<char *>(&messageLength),
-                                  sizeof(SizeType));
-            bytesRead == sizeof(SizeType)) {
-          auto payload = srz::Buffer{};
-          payload.resize(messageLength);
-          while (totalRead < messageLength) {
-            if (bytesRead = read(sd, payload.data() + totalRead, messageLength);
-                bytesRead != -1) {
-              totalRead += bytesRead;
+void LocalIPCBufferReceiverImpl::onControlFrame(ClientConnection &connection,
+                                                srz::Buffer &&payload) {
+  // The only control frame is the hello of a multiplexed client, carrying
+  // the address it expects messages back on
+  if (payload.empty() || !connection.peerName.empty()) {
+    MAF_LOGGER_WARN("Ignored unexpected control frame from connection ",
+                    static_cast<SockFD>(connection.peer->fd));
+    return;
+  }
+  connection.peerName = std::move(payload);
+  (*peers_.atomic())[connection.peerName] = connection.peer;
+}
+
+bool LocalIPCBufferReceiverImpl::readFrames(SockFD sd) {
+  auto itConnection = clientConnections_.find(sd);
+  if (itConnection == clientConnections_.end()) {
+    return false;
+  }
+
+  // Edge triggered, then must read until there's no more pending byte
+  while (true) {
+    auto bytesRead = read(sd, readBuffer_.data(), readBuffer_.size());
+    if (bytesRead > 0) {
+      auto &connection = itConnection->second;
+      connection.assembler.feed(
+          readBuffer_.data(), static_cast<size_t>(bytesRead),
+          [this, &connection](srz::Buffer &&payload, bool control) {
+            if (control) {
+              onControlFrame(connection, std::move(payload));
             } else {
-              MAF_SOCKET_ERROR("Could not read bytes from socket total read = ",
-                               totalRead, " total expected = ", messageLength);
-              break;
+              bytesComeCallback_(std::move(payload));
             }
-          }
-          if (totalRead == messageLength) {
-            bytesComeCallback_(std::move(payload));
-          }
-        }
-        close(sd);
-        fdClientSocks[i] = 0;
-      }
+          });
+    } else if (bytesRead == 0) {
+      // Sender closed the connection
+      return false;
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return true;
+    } else {
+      MAF_SOCKET_ERROR("Could not read bytes from socket");
+      return false;
     }
-  } while (true);
-
-  setState(State::Stopped);
-  return true;
+  }
 }
 
 void LocalIPCBufferReceiverImpl::changeCurrentStateAndInterruptIfStop(
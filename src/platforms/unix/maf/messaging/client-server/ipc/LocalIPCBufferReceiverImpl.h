@@ -1,10 +1,18 @@
 #pragma once
 
+#include <maf/messaging/client-server/CSStatus.h>
+#include <maf/threading/Lockable.h>
 #include <maf/utils/serialization/Buffer.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <future>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
+#include "FrameAssembler.h"
 #include "SocketShared.h"
 
 namespace maf {
@@ -25,6 +33,7 @@ class LocalIPCBufferReceiverImpl {
   bool running() const;
   const Address &address() const;
   void setObserver(BytesComeCallback callback);
+  ActionCallStatus sendBack(const srz::Buffer &payload, const Address &peer);
 
  private:
   enum class State : char {
@@ -37,16 +46,53 @@ class LocalIPCBufferReceiverImpl {
 
   class StoppedInterruption {};
 
+  // Writable side of an accepted connection, shared with threads sending
+  // back to the peer then the fd stays valid until the last writer is done.
+  // One writer at a time owns the fd, the mutex is not held while it waits
+  // for the peer to read
+  struct Peer {
+    std::mutex mutex;
+    std::condition_variable writerDone;
+    bool writing = false;
+    bool dropped = false;
+    AutoCloseFD<SockFD> fd;
+  };
+  using PeerPtr = std::shared_ptr<Peer>;
+
+  struct ClientConnection {
+    PeerPtr peer;
+    FrameAssembler assembler;
+    // Address the peer introduced itself with, empty if it didn't
+    SocketPath peerName;
+  };
+  using Peers = threading::Lockable<std::map<SocketPath, PeerPtr>>;
+
   State getState() const { return state_.load(std::memory_order_acquire); }
   void setState(State state) { state_.store(state, std::memory_order_release); }
 
+  bool initEventLoop();
+  void drainWakeup();
   bool waitAndProcessConnections();
+  void acceptConnections();
+  bool rejectConnection();
+  void closeConnection(SockFD sd);
+  bool readFrames(SockFD sd);
+  void onControlFrame(ClientConnection &connection, srz::Buffer &&payload);
+  void closeAllConnections();
   void changeCurrentStateAndInterruptIfStop(State expectedCurrentSate, State newStateState);
 
   BytesComeCallback bytesComeCallback_;
   Address myaddr_;
   sockaddr_un mySockAddr_;
-  int fdMySock_;
+  AutoCloseFD<SockFD> fdMySock_;
+  AutoCloseFD<FD> fdEpoll_;
+  AutoCloseFD<FD> fdWakeup_;
+  // Kept open to be given up when the process runs out of descriptors, then
+  // a pending connection can still be accepted and closed
+  AutoCloseFD<FD> fdSpare_;
+  std::unordered_map<SockFD, ClientConnection> clientConnections_;
+  Peers peers_;
+  std::vector<char> readBuffer_;
   std::atomic<State> state_ = State::Uninitialized;
 };
 
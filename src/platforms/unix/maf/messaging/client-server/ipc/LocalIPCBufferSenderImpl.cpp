@@ -43,47 +43,55 @@ Availability LocalIPCBufferSenderImpl::checkReceiverStatus(
 
 ActionCallStatus LocalIPCBufferSenderImpl::send(const Buffer &payload,
                                                 const SocketPath &sockpath) {
-  ActionCallStatus acs = ActionCallStatus::FailedUnknown;
-  if (auto fd = connectToSocket(sockpath); fd != INVALID_FD) {
-    SizeType totalWritten = 0;
-    SizeType payloadSize = static_cast<SizeType>(payload.length());
+  auto connection = getConnection(sockpath);
+  std::lock_guard lock(connection->mutex);
 
-    // First write is to send payload size to receiver to reserve a buffer
-    if (auto written = ns_global::write(
-            fd, reinterpret_cast<char *>(&payloadSize), sizeof(SizeType));
-        written == sizeof(SizeType)) {
-      // Second write is to send payload content
-      do {
-        if (written = ns_global::write(fd, payload.data() + totalWritten,
-                                       payloadSize - totalWritten);
-            written != -1) {
-          totalWritten += written;
-        } else {
-          MAF_SOCKET_ERROR("Failed to send bytes to receiver, total written = ",
-                           totalWritten);
-          acs = ActionCallStatus::FailedUnknown;
-          break;
-        }
-      } while (totalWritten < payloadSize);
+  // The cached connection might have been closed by receiver since the last
+  // send, in that case try once more with a fresh connection
+  for (auto attempt = 0; attempt < 2; ++attempt) {
+    auto reused = connection->fd != INVALID_FD;
+    if (!reused) {
+      if (connection->fd = connectToSocket(sockpath);
+          connection->fd == INVALID_FD) {
+        removeConnection(sockpath, connection);
+        return ActionCallStatus::ReceiverUnavailable;
+      }
+    }
 
-      acs = ActionCallStatus::Success;
-    } else {
-      MAF_SOCKET_ERROR("Failed to send payload size[", payloadSize,
-                       "] to receiver");
+    if (sendFrame(connection->fd, payload)) {
+      return ActionCallStatus::Success;
     }
 
-    if (acs != ActionCallStatus::Success) {
-      if (totalWritten == 0) {
-      } else {
-        // ec = FailedUnknown, must provide more info for debugging purpose
-        MAF_LOGGER_ERROR("Failed to send payload to receiver, expected is ",
-                         sizeof(SizeType), ", sent was ", totalWritten);
-      }
+    auto err = errno;
+    connection->fd.reset();
+    if (!reused || !isBrokenConnectionError(err)) {
+      MAF_LOGGER_ERROR("Failed to send payload of ", payload.length(),
+                       " bytes to receiver ", sockpath, " with errno = ", err,
+                       "!");
+      return err == ETIMEDOUT ? ActionCallStatus::Timeout
+                              : ActionCallStatus::FailedUnknown;
     }
-  } else {
-    acs = ActionCallStatus::ReceiverUnavailable;
   }
-  return acs;
+  return ActionCallStatus::FailedUnknown;
+}
+
+LocalIPCBufferSenderImpl::ConnectionPtr LocalIPCBufferSenderImpl::getConnection(
+    const SocketPath &sockpath) {
+  std::lock_guard lock(connections_);
+  auto &connection = (*connections_)[sockpath];
+  if (!connection) {
+    connection = std::make_shared<Connection>();
+  }
+  return connection;
+}
+
+void LocalIPCBufferSenderImpl::removeConnection(
+    const SocketPath &sockpath, const ConnectionPtr &connection) {
+  std::lock_guard lock(connections_);
+  if (auto it = connections_->find(sockpath);
+      it != connections_->end() && it->second == connection) {
+    connections_->erase(it);
+  }
 }
 
 }  // namespace local
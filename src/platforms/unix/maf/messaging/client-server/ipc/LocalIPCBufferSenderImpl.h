@@ -1,8 +1,13 @@
 #pragma once
 
 #include <maf/messaging/client-server/CSStatus.h>
+#include <maf/threading/Lockable.h>
 #include <maf/utils/serialization/Buffer.h>
 
+#include <map>
+#include <memory>
+#include <mutex>
+
 #include "SocketShared.h"
 
 namespace maf {
@@ -17,6 +22,23 @@ class LocalIPCBufferSenderImpl {
   ActionCallStatus send(const Buffer &payload, const Address &destination);
   ActionCallStatus send(const Buffer &payload, const SocketPath &sockpath);
   Availability checkReceiverStatus(const Address &destination) const;
+
+ private:
+  // A persistent connection to one receiver, frames written to it must not
+  // interleave then writers are serialized by its mutex
+  struct Connection {
+    std::mutex mutex;
+    AutoCloseFD<SockFD> fd;
+  };
+  using ConnectionPtr = std::shared_ptr<Connection>;
+  using Connections =
+      threading::Lockable<std::map<SocketPath, ConnectionPtr>>;
+
+  ConnectionPtr getConnection(const SocketPath &sockpath);
+  void removeConnection(const SocketPath &sockpath,
+                        const ConnectionPtr &connection);
+
+  Connections connections_;
 };
 
 }  // namespace local
@@ -0,0 +1,247 @@
+#include "LocalIPCClientConnectionImpl.h"
+
+#include <fcntl.h>
+#include <maf/logging/Logger.h>
+#include <maf/utils/CallOnExit.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace local {
+
+static constexpr int MAX_EVENTS_PER_WAIT = 8;
+static constexpr size_t READ_CHUNK_SIZE = 64 * 1024;
+
+LocalIPCClientConnectionImpl::~LocalIPCClientConnectionImpl() { stop(); }
+
+bool LocalIPCClientConnectionImpl::init(const Address &myAddr) {
+  myaddr_ = myAddr;
+  if (fdEpoll_ = epoll_create1(EPOLL_CLOEXEC); fdEpoll_ == INVALID_FD) {
+    MAF_SOCKET_ERROR("Could not create epoll instance");
+    return false;
+  }
+  if (fdWakeup_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      fdWakeup_ == INVALID_FD) {
+    MAF_SOCKET_ERROR("Could not create eventfd for waking up connection");
+    return false;
+  }
+
+  epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.fd = fdWakeup_;
+  if (epoll_ctl(fdEpoll_, EPOLL_CTL_ADD, fdWakeup_, &ev) != 0) {
+    MAF_SOCKET_ERROR("Could not register wakeup event to epoll instance");
+    return false;
+  }
+  return true;
+}
+
+bool LocalIPCClientConnectionImpl::start() {
+  if (fdEpoll_ == INVALID_FD || running_.exchange(true)) {
+    return false;
+  }
+
+  epoll_event events[MAX_EVENTS_PER_WAIT];
+  readBuffer_.resize(READ_CHUNK_SIZE);
+
+  util::CallOnExit closeConnection = [this] {
+    if (auto connection = currentConnection()) {
+      dropConnection(connection);
+    }
+    running_ = false;
+  };
+
+  while (!stopped_) {
+    auto totalEvents = epoll_wait(fdEpoll_, events, MAX_EVENTS_PER_WAIT, -1);
+    if (totalEvents < 0) {
+      if (errno != EINTR) {
+        MAF_SOCKET_ERROR("Failed on waiting for connection events");
+        return false;
+      }
+      continue;
+    }
+
+    for (int i = 0; i < totalEvents && !stopped_; ++i) {
+      auto fd = events[i].data.fd;
+      if (fd == fdWakeup_) {
+        continue;
+      }
+      // The event might belong to a connection already dropped by sender
+      if (auto connection = currentConnection();
+          connection && connection->fd == fd) {
+        if ((events[i].events & EPOLLERR) || !readFrames(connection)) {
+          dropConnection(connection);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+void LocalIPCClientConnectionImpl::stop() {
+  // Stop might come before receiving thread starts, then the flag stays
+  if (!stopped_.exchange(true) && fdWakeup_ != INVALID_FD) {
+    uint64_t one = 1;
+    if (write(fdWakeup_, &one, sizeof(one)) != sizeof(one)) {
+      MAF_SOCKET_ERROR("Could not wake up connection of ", myaddr_.dump());
+    }
+  }
+}
+
+void LocalIPCClientConnectionImpl::deinit() {}
+
+bool LocalIPCClientConnectionImpl::running() const { return running_; }
+
+const Address &LocalIPCClientConnectionImpl::address() const {
+  return myaddr_;
+}
+
+void LocalIPCClientConnectionImpl::setObserver(BytesComeCallback callback) {
+  bytesComeCallback_ = std::move(callback);
+}
+
+ActionCallStatus LocalIPCClientConnectionImpl::send(const Buffer &payload,
+                                                    const Address &serverAddr) {
+  std::lock_guard lock(sendMutex_);
+
+  // The connection might have been closed by server since the last send, in
+  // that case try once more with a fresh connection
+  for (auto attempt = 0; attempt < 2; ++attempt) {
+    auto connection = currentConnection();
+    auto reused = connection != nullptr;
+    if (!reused) {
+      if (connection = connect(serverAddr.get_name()); !connection) {
+        return ActionCallStatus::ReceiverUnavailable;
+      }
+    }
+
+    if (sendFrame(connection->fd, payload)) {
+      return ActionCallStatus::Success;
+    }
+
+    auto err = errno;
+    dropConnection(connection);
+    if (!reused || !isBrokenConnectionError(err)) {
+      MAF_LOGGER_ERROR("Failed to send payload of ", payload.length(),
+                       " bytes to server ", serverAddr.dump(),
+                       " with errno = ", err, "!");
+      return err == ETIMEDOUT ? ActionCallStatus::Timeout
+                              : ActionCallStatus::FailedUnknown;
+    }
+  }
+  return ActionCallStatus::FailedUnknown;
+}
+
+Availability LocalIPCClientConnectionImpl::checkReceiverStatus(
+    const Address &serverAddr) {
+  // Report the loss once even if server is back already, then client gets
+  // the chance to register to the new server instance again
+  if (connectionLost_.exchange(false)) {
+    return Availability::Unavailable;
+  }
+
+  std::lock_guard lock(sendMutex_);
+  return currentConnection() || connect(serverAddr.get_name())
+             ? Availability::Available
+             : Availability::Unavailable;
+}
+
+LocalIPCClientConnectionImpl::ConnectionPtr
+LocalIPCClientConnectionImpl::currentConnection() {
+  return *connection_.atomic();
+}
+
+LocalIPCClientConnectionImpl::ConnectionPtr
+LocalIPCClientConnectionImpl::connect(const SocketPath &sockpath) {
+  if (!isValidSocketPath(sockpath) || fdEpoll_ == INVALID_FD) {
+    return {};
+  }
+
+  AutoCloseFD<SockFD> fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == INVALID_FD) {
+    MAF_SOCKET_ERROR("Could not allocate new socket");
+    return {};
+  }
+  // Server being unavailable is expected here, then not an error to log
+  auto addr = createUnixAbstractSocketAddr(sockpath);
+  if (::connect(fd, _2sockAddr(&addr), sizeof(addr)) != 0) {
+    return {};
+  }
+
+  // Introduce ourself before anything else goes on the connection
+  if (!sendFrame(fd, myaddr_.get_name(), CONTROL_FRAME_FLAG)) {
+    MAF_SOCKET_ERROR("Could not say hello to server ", sockpath);
+    return {};
+  }
+  if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+    MAF_SOCKET_ERROR("Could not make connection to ", sockpath,
+                     " non-blocking");
+    return {};
+  }
+
+  auto connection = std::make_shared<Connection>();
+  connection->fd = std::move(fd);
+  *connection_.atomic() = connection;
+
+  epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+  ev.data.fd = connection->fd;
+  if (epoll_ctl(fdEpoll_, EPOLL_CTL_ADD, connection->fd, &ev) != 0) {
+    MAF_SOCKET_ERROR("Could not register connection to epoll instance");
+    dropConnection(connection);
+    return {};
+  }
+  return connection;
+}
+
+void LocalIPCClientConnectionImpl::dropConnection(
+    const ConnectionPtr &connection) {
+  {
+    std::lock_guard lock(connection_);
+    if (*connection_ != connection) {
+      return;
+    }
+    connection_->reset();
+  }
+
+  epoll_ctl(fdEpoll_, EPOLL_CTL_DEL, connection->fd, nullptr);
+  // Other holders fail fast, fd is closed by the last one
+  shutdown(connection->fd, SHUT_RDWR);
+  connectionLost_ = true;
+}
+
+bool LocalIPCClientConnectionImpl::readFrames(
+    const ConnectionPtr &connection) {
+  // Edge triggered, then must read until there's no more pending byte
+  while (true) {
+    auto bytesRead = read(connection->fd, readBuffer_.data(), readBuffer_.size());
+    if (bytesRead > 0) {
+      connection->assembler.feed(
+          readBuffer_.data(), static_cast<size_t>(bytesRead),
+          [this](srz::Buffer &&payload, bool control) {
+            if (!control) {
+              bytesComeCallback_(std::move(payload));
+            }
+          });
+    } else if (bytesRead == 0) {
+      // Server closed the connection
+      return false;
+    } else if (errno == EINTR) {
+      continue;
+    } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return true;
+    } else {
+      MAF_SOCKET_ERROR("Could not read bytes from server connection");
+      return false;
+    }
+  }
+}
+
+}  // namespace local
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
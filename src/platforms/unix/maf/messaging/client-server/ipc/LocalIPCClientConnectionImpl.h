@@ -0,0 +1,77 @@
+#pragma once
+
+#include <maf/messaging/client-server/CSStatus.h>
+#include <maf/threading/Lockable.h>
+#include <maf/utils/serialization/Buffer.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "FrameAssembler.h"
+#include "SocketShared.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace local {
+
+using BytesComeCallback = std::function<void(srz::Buffer &&)>;
+
+// Client side of a multiplexed connection: one long-lived socket to the
+// server carries requests one way and responses/notifications the other way,
+// then client doesn't need to listen for server connecting back.
+// Server knows which connection to answer on by the hello control frame
+// carrying client address, sent first on every new connection.
+class LocalIPCClientConnectionImpl {
+ public:
+  using Buffer = maf::srz::Buffer;
+
+  ~LocalIPCClientConnectionImpl();
+
+  // receiving side
+  bool init(const Address &myAddr);
+  bool start();
+  void stop();
+  void deinit();
+  bool running() const;
+  const Address &address() const;
+  void setObserver(BytesComeCallback callback);
+
+  // sending side
+  ActionCallStatus send(const Buffer &payload, const Address &serverAddr);
+  Availability checkReceiverStatus(const Address &serverAddr);
+
+ private:
+  struct Connection {
+    AutoCloseFD<SockFD> fd;
+    // touched by receiving thread only
+    FrameAssembler assembler;
+  };
+  using ConnectionPtr = std::shared_ptr<Connection>;
+
+  ConnectionPtr currentConnection();
+  ConnectionPtr connect(const SocketPath &sockpath);
+  void dropConnection(const ConnectionPtr &connection);
+  bool readFrames(const ConnectionPtr &connection);
+
+  BytesComeCallback bytesComeCallback_;
+  Address myaddr_;
+  AutoCloseFD<FD> fdEpoll_;
+  AutoCloseFD<FD> fdWakeup_;
+  // serializes writers and connection establishment
+  std::mutex sendMutex_;
+  threading::Lockable<ConnectionPtr> connection_;
+  // connection broke since last status check, server might have restarted
+  std::atomic_bool connectionLost_ = false;
+  std::atomic_bool running_ = false;
+  std::atomic_bool stopped_ = false;
+  std::vector<char> readBuffer_;
+};
+
+}  // namespace local
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -0,0 +1,286 @@
+#include "ShmIPCBufferReceiverImpl.h"
+
+#include <maf/logging/Logger.h>
+#include <maf/utils/CallOnExit.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "ShmIPCBufferSenderImpl.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+static constexpr int MAX_EVENTS_PER_WAIT = 64;
+
+static bool addToEpoll(FD epollFD, FD fd, uint32_t events) {
+  epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.fd = fd;
+  return epoll_ctl(epollFD, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+ShmIPCBufferReceiverImpl::~ShmIPCBufferReceiverImpl() { stop(); }
+
+bool ShmIPCBufferReceiverImpl::init(const Address &addr) {
+  myaddr_ = addr;
+  auto sockpath = controlSocketPath(myaddr_);
+  if (!isValidSocketPath(sockpath)) {
+    MAF_LOGGER_ERROR(
+        "Length of address exeeds the limitation of unix domain socket path");
+    return false;
+  }
+
+  mySockAddr_ = createUnixAbstractSocketAddr(sockpath);
+  fdMySock_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fdMySock_ == INVALID_FD) {
+    MAF_SOCKET_ERROR("Could not allocate new socket");
+  } else if (bind(fdMySock_, _2sockAddr(&mySockAddr_), sizeof(mySockAddr_)) <
+             0) {
+    MAF_SOCKET_ERROR("Coud not bind socket to address ", myaddr_.dump());
+  } else if (listen(fdMySock_, SOMAXCONN) != 0) {
+    MAF_SOCKET_ERROR("Could not listen on socket");
+  } else if (initEventLoop()) {
+    MAF_LOGGER_INFO("Listening for shared memory senders on address ",
+                    myaddr_.dump());
+    setState(State::Initialized);
+    return true;
+  }
+  return false;
+}
+
+bool ShmIPCBufferReceiverImpl::initEventLoop() {
+  if (fdEpoll_ = epoll_create1(EPOLL_CLOEXEC); fdEpoll_ == INVALID_FD) {
+    MAF_SOCKET_ERROR("Could not create epoll instance");
+    return false;
+  }
+  if (fdWakeup_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      fdWakeup_ == INVALID_FD) {
+    MAF_SOCKET_ERROR("Could not create eventfd for waking up receiver");
+    return false;
+  }
+  if (!addToEpoll(fdEpoll_, fdWakeup_, EPOLLIN) ||
+      !addToEpoll(fdEpoll_, fdMySock_, EPOLLIN | EPOLLET)) {
+    MAF_SOCKET_ERROR("Could not register fds to epoll instance");
+    return false;
+  }
+  return true;
+}
+
+bool ShmIPCBufferReceiverImpl::start() {
+  try {
+    if (getState() == State::Initialized) {
+      setState(State::Running);
+      waitAndProcessEvents();
+    } else {
+      return false;
+    }
+  } catch (StoppedInterruption) {
+  } catch (...) {
+    return false;
+  }
+  return true;
+}
+
+void ShmIPCBufferReceiverImpl::stop() {
+  if (running()) {
+    setState(State::Stopped);
+    uint64_t one = 1;
+    if (write(fdWakeup_, &one, sizeof(one)) != sizeof(one)) {
+      MAF_SOCKET_ERROR("Could not wake up receiver at ", myaddr_.dump());
+    }
+  }
+}
+
+void ShmIPCBufferReceiverImpl::deinit() {}
+
+bool ShmIPCBufferReceiverImpl::running() const {
+  switch (getState()) {
+    case State::Running:
+    case State::WaitingConnection:
+      return true;
+    default:
+      return false;
+  }
+}
+
+const Address &ShmIPCBufferReceiverImpl::address() const { return myaddr_; }
+
+void ShmIPCBufferReceiverImpl::setObserver(BytesComeCallback callback) {
+  bytesComeCallback_ = std::move(callback);
+}
+
+bool ShmIPCBufferReceiverImpl::waitAndProcessEvents() {
+  epoll_event events[MAX_EVENTS_PER_WAIT];
+  util::CallOnExit closeChannels = [this] { closeAllChannels(); };
+
+  do {
+    changeCurrentStateAndInterruptIfStop(State::Running,
+                                         State::WaitingConnection);
+
+    auto totalEvents = epoll_wait(fdEpoll_, events, MAX_EVENTS_PER_WAIT, -1);
+
+    changeCurrentStateAndInterruptIfStop(State::WaitingConnection,
+                                         State::Running);
+
+    if (totalEvents < 0) {
+      if (errno != EINTR) {
+        MAF_SOCKET_ERROR("Failed on waiting for shared memory events");
+        return false;
+      }
+      continue;
+    }
+
+    for (int i = 0; i < totalEvents; ++i) {
+      auto fd = events[i].data.fd;
+      if (fd == fdMySock_) {
+        acceptConnections();
+      } else if (fd == fdWakeup_) {
+        continue;
+      } else if (auto itDoorbell = doorbells_.find(fd);
+                 itDoorbell != doorbells_.end()) {
+        auto control = itDoorbell->second;
+        uint64_t rings = 0;
+        if (read(fd, &rings, sizeof(rings)) < 0 && errno != EAGAIN) {
+          MAF_SOCKET_ERROR("Could not read shared memory doorbell");
+        }
+        if (!drain(*channels_.at(control))) {
+          closeChannel(control);
+        }
+      } else if (auto itChannel = channels_.find(fd);
+                 itChannel != channels_.end()) {
+        auto &channel = *itChannel->second;
+        if (!channel.ring.valid()) {
+          if (!establishChannel(channel)) {
+            closeChannel(fd);
+          }
+        } else {
+          // Sender went away, take its last frames before closing
+          drain(channel);
+          closeChannel(fd);
+        }
+      }
+    }
+  } while (true);
+
+  setState(State::Stopped);
+  return true;
+}
+
+void ShmIPCBufferReceiverImpl::acceptConnections() {
+  while (true) {
+    auto acceptedSD =
+        accept4(fdMySock_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (acceptedSD == INVALID_FD) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        MAF_SOCKET_ERROR("Failed on accepting new socket connection");
+      }
+      break;
+    }
+
+    auto channel = std::make_unique<Channel>();
+    channel->control = acceptedSD;
+    if (addToEpoll(fdEpoll_, acceptedSD, EPOLLIN | EPOLLRDHUP)) {
+      channels_.emplace(acceptedSD, std::move(channel));
+    } else {
+      MAF_SOCKET_ERROR("Could not register new connection to epoll instance");
+    }
+  }
+}
+
+bool ShmIPCBufferReceiverImpl::establishChannel(Channel &channel) {
+  FD fds[2] = {INVALID_FD, INVALID_FD};
+  auto count = receiveFileDescriptors(channel.control, fds, 2);
+  if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    return true;
+  }
+
+  if (count != 2) {
+    // Plain connection to check availability, or misbehaving sender
+    for (auto i = 0; i < count; ++i) {
+      close(fds[i]);
+    }
+    return false;
+  }
+
+  channel.doorbell = fds[1];
+  if (!channel.ring.attach(fds[0])) {
+    return false;
+  }
+
+  if (!addToEpoll(fdEpoll_, channel.doorbell, EPOLLIN)) {
+    MAF_SOCKET_ERROR("Could not register shared memory doorbell to epoll");
+    return false;
+  }
+  doorbells_.emplace(channel.doorbell, channel.control);
+  return drain(channel);
+}
+
+bool ShmIPCBufferReceiverImpl::drain(Channel &channel) {
+  if (!channel.ring.valid()) {
+    return true;
+  }
+
+  auto onFrame = [this](srz::Buffer &&payload, bool /*control*/) {
+    bytesComeCallback_(std::move(payload));
+  };
+  do {
+    if (!channel.ring.read([&channel, &onFrame](const char *data,
+                                                size_t length) {
+          channel.assembler.feed(data, length, onFrame);
+        })) {
+      MAF_LOGGER_ERROR("Shared memory ring of address ", myaddr_.dump(),
+                       " is corrupted");
+      return false;
+    }
+    // Sleep on the doorbell only when nothing came while announcing it
+  } while (!channel.ring.park());
+  return true;
+}
+
+void ShmIPCBufferReceiverImpl::closeChannel(SockFD control) {
+  auto itChannel = channels_.find(control);
+  if (itChannel == channels_.end()) {
+    return;
+  }
+
+  auto &channel = *itChannel->second;
+  if (channel.doorbell != INVALID_FD) {
+    epoll_ctl(fdEpoll_, EPOLL_CTL_DEL, channel.doorbell, nullptr);
+    doorbells_.erase(channel.doorbell);
+  }
+  epoll_ctl(fdEpoll_, EPOLL_CTL_DEL, control, nullptr);
+  channel.ring.close();
+  channels_.erase(itChannel);
+}
+
+void ShmIPCBufferReceiverImpl::closeAllChannels() {
+  // Nobody will drain rings handed over from now on, then refuse them instead
+  // of letting senders wait for space forever
+  fdMySock_.reset();
+  for (auto &[control, channel] : channels_) {
+    channel->ring.close();
+  }
+  channels_.clear();
+  doorbells_.clear();
+}
+
+void ShmIPCBufferReceiverImpl::changeCurrentStateAndInterruptIfStop(
+    State expectedCurrentSate, State newStateState) {
+  state_.compare_exchange_strong(expectedCurrentSate, newStateState);
+  if (expectedCurrentSate == State::Stopped) {
+    MAF_LOGGER_INFO("Finish running due to flag STOP was turned on, address: ",
+                    myaddr_.dump());
+    throw StoppedInterruption{};
+  }
+}
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <maf/utils/serialization/Buffer.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include "FrameAssembler.h"
+#include "ShmRing.h"
+#include "SocketShared.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+using BytesComeCallback = std::function<void(srz::Buffer &&)>;
+
+class ShmIPCBufferReceiverImpl {
+ public:
+  ~ShmIPCBufferReceiverImpl();
+  bool init(const Address &addr);
+  bool start();
+  void stop();
+  void deinit();
+  bool running() const;
+  const Address &address() const;
+  void setObserver(BytesComeCallback callback);
+
+ private:
+  enum class State : char {
+    Uninitialized,
+    Initialized,
+    Running,
+    WaitingConnection,
+    Stopped
+  };
+
+  class StoppedInterruption {};
+
+  // Ring handed over by one sender, control socket stays open to tell when
+  // the sender is gone
+  struct Channel {
+    AutoCloseFD<SockFD> control;
+    AutoCloseFD<FD> doorbell;
+    ShmRing ring;
+    FrameAssembler assembler;
+  };
+
+  State getState() const { return state_.load(std::memory_order_acquire); }
+  void setState(State state) { state_.store(state, std::memory_order_release); }
+
+  bool initEventLoop();
+  bool waitAndProcessEvents();
+  void acceptConnections();
+  bool establishChannel(Channel &channel);
+  bool drain(Channel &channel);
+  void closeChannel(SockFD control);
+  void closeAllChannels();
+  void changeCurrentStateAndInterruptIfStop(State expectedCurrentSate,
+                                            State newStateState);
+
+  BytesComeCallback bytesComeCallback_;
+  Address myaddr_;
+  sockaddr_un mySockAddr_;
+  AutoCloseFD<SockFD> fdMySock_;
+  AutoCloseFD<FD> fdEpoll_;
+  AutoCloseFD<FD> fdWakeup_;
+  // keyed by control socket
+  std::unordered_map<SockFD, std::unique_ptr<Channel>> channels_;
+  // doorbell -> control socket of same channel
+  std::unordered_map<FD, SockFD> doorbells_;
+  std::atomic<State> state_ = State::Uninitialized;
+};
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -0,0 +1,169 @@
+#include "ShmIPCBufferSenderImpl.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+// Upper bound of a producer sleep on full ring before checking that the
+// receiver is still there
+static constexpr std::chrono::milliseconds FULL_RING_WAIT_SLICE{10};
+
+static bool peerHungUp(SockFD sock) {
+  // Receiver never writes to the control socket, then readable means EOF
+  pollfd pfd{sock, POLLIN, 0};
+  return poll(&pfd, 1, 0) != 0;
+}
+
+ActionCallStatus ShmIPCBufferSenderImpl::send(const Buffer &payload,
+                                              const Address &destination) {
+  auto sockpath = controlSocketPath(destination);
+  auto channel = getChannel(sockpath);
+  std::lock_guard lock(channel->mutex);
+
+  // The cached ring might have been abandoned by receiver since the last
+  // send, in that case try once more with a fresh one
+  for (auto attempt = 0; attempt < 2; ++attempt) {
+    auto reused = channel->ring.valid();
+    if (!reused && !open(*channel, sockpath)) {
+      removeChannel(sockpath, channel);
+      return ActionCallStatus::ReceiverUnavailable;
+    }
+
+    if (writeFrame(*channel, payload)) {
+      return ActionCallStatus::Success;
+    }
+
+    close(*channel);
+    if (!reused) {
+      MAF_LOGGER_ERROR("Failed to send payload of ", payload.length(),
+                       " bytes to shared memory receiver ", sockpath);
+      break;
+    }
+  }
+  return ActionCallStatus::FailedUnknown;
+}
+
+Availability ShmIPCBufferSenderImpl::checkReceiverStatus(
+    const Address &destination) const {
+  auto sockpath = controlSocketPath(destination);
+  if (!isValidSocketPath(sockpath)) {
+    return Availability::Unavailable;
+  }
+
+  AutoCloseFD<SockFD> fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd == INVALID_FD) {
+    MAF_SOCKET_ERROR("Cannot create socket");
+    return Availability::Unavailable;
+  }
+  auto addr = createUnixAbstractSocketAddr(sockpath);
+  return connect(fd, _2sockAddr(&addr), sizeof(addr)) == 0
+             ? Availability::Available
+             : Availability::Unavailable;
+}
+
+bool ShmIPCBufferSenderImpl::open(Channel &channel,
+                                  const SocketPath &sockpath) {
+  if (channel.control = connectToSocket(sockpath);
+      channel.control == INVALID_FD) {
+    return false;
+  }
+
+  if (channel.ring.create()) {
+    if (channel.doorbell = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        channel.doorbell != INVALID_FD) {
+      FD fds[] = {channel.ring.fd(), channel.doorbell};
+      if (sendFileDescriptors(channel.control, fds, 2)) {
+        return true;
+      }
+      MAF_SOCKET_ERROR("Could not hand shared memory ring over to ", sockpath);
+    } else {
+      MAF_SOCKET_ERROR("Could not create eventfd for shared memory doorbell");
+    }
+  }
+
+  close(channel);
+  return false;
+}
+
+void ShmIPCBufferSenderImpl::close(Channel &channel) {
+  channel.control.reset();
+  channel.doorbell.reset();
+  channel.ring.reset();
+}
+
+bool ShmIPCBufferSenderImpl::writeFrame(Channel &channel,
+                                        const Buffer &payload) {
+  auto payloadSize = static_cast<SizeType>(payload.length());
+  if (!writeBytes(channel, reinterpret_cast<const char *>(&payloadSize),
+                  sizeof(SizeType)) ||
+      !writeBytes(channel, payload.data(), payload.length())) {
+    return false;
+  }
+
+  // Only wake the receiver up if it went to sleep, busy receiver will see
+  // the new frame on its next round of draining
+  if (channel.ring.takeConsumerWaiting()) {
+    ringDoorbell(channel);
+  }
+  return true;
+}
+
+bool ShmIPCBufferSenderImpl::writeBytes(Channel &channel, const char *data,
+                                        size_t length) {
+  while (length > 0) {
+    if (channel.ring.consumerClosed()) {
+      return false;
+    }
+
+    auto written = channel.ring.write(data, length);
+    data += written;
+    length -= written;
+
+    if (written == 0) {
+      // Ring is full, make sure receiver is draining it before sleeping
+      if (channel.ring.takeConsumerWaiting()) {
+        ringDoorbell(channel);
+      }
+      channel.ring.waitForSpace(FULL_RING_WAIT_SLICE);
+      if (peerHungUp(channel.control)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void ShmIPCBufferSenderImpl::ringDoorbell(Channel &channel) {
+  uint64_t one = 1;
+  if (write(channel.doorbell, &one, sizeof(one)) != sizeof(one)) {
+    MAF_SOCKET_ERROR("Could not ring shared memory doorbell");
+  }
+}
+
+ShmIPCBufferSenderImpl::ChannelPtr ShmIPCBufferSenderImpl::getChannel(
+    const SocketPath &sockpath) {
+  std::lock_guard lock(channels_);
+  auto &channel = (*channels_)[sockpath];
+  if (!channel) {
+    channel = std::make_shared<Channel>();
+  }
+  return channel;
+}
+
+void ShmIPCBufferSenderImpl::removeChannel(const SocketPath &sockpath,
+                                           const ChannelPtr &channel) {
+  std::lock_guard lock(channels_);
+  if (auto it = channels_->find(sockpath);
+      it != channels_->end() && it->second == channel) {
+    channels_->erase(it);
+  }
+}
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
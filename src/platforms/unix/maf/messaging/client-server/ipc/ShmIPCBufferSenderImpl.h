@@ -0,0 +1,59 @@
+#pragma once
+
+#include <maf/messaging/client-server/CSStatus.h>
+#include <maf/threading/Lockable.h>
+#include <maf/utils/serialization/Buffer.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "ShmRing.h"
+#include "SocketShared.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+// Path of the unix socket that a shared memory receiver listens on for
+// handing over rings, kept apart from the local ipc sockets of same name
+inline SocketPath controlSocketPath(const Address &addr) {
+  return "maf.shm/" + addr.get_name();
+}
+
+class ShmIPCBufferSenderImpl {
+ public:
+  using Buffer = maf::srz::Buffer;
+
+  ActionCallStatus send(const Buffer &payload, const Address &destination);
+  Availability checkReceiverStatus(const Address &destination) const;
+
+ private:
+  // One ring per receiver. The control socket carries the ring and doorbell
+  // fds to receiver once, then only tells each side that the other is gone.
+  struct Channel {
+    std::mutex mutex;
+    AutoCloseFD<SockFD> control;
+    AutoCloseFD<FD> doorbell;
+    ShmRing ring;
+  };
+  using ChannelPtr = std::shared_ptr<Channel>;
+  using Channels = threading::Lockable<std::map<SocketPath, ChannelPtr>>;
+
+  static bool open(Channel &channel, const SocketPath &sockpath);
+  static void close(Channel &channel);
+  static bool writeFrame(Channel &channel, const Buffer &payload);
+  static bool writeBytes(Channel &channel, const char *data, size_t length);
+  static void ringDoorbell(Channel &channel);
+
+  ChannelPtr getChannel(const SocketPath &sockpath);
+  void removeChannel(const SocketPath &sockpath, const ChannelPtr &channel);
+
+  Channels channels_;
+};
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
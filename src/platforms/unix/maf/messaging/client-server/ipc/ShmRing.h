@@ -0,0 +1,239 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#include "SocketShared.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+
+// Control block placed at the beginning of the shared memory, the data area
+// follows it. Producer and consumer live in different processes, then all
+// fields must be lock-free atomics.
+struct ShmRingHeader {
+  using Position = std::atomic<uint64_t>;
+  using Flag = std::atomic<uint32_t>;
+  static_assert(Position::is_always_lock_free && Flag::is_always_lock_free,
+                "Ring positions must be lock-free to be shared by processes");
+
+  // written by producer only
+  alignas(64) Position head{0};
+  // written by consumer only
+  alignas(64) Position tail{0};
+  // consumer is parked on the doorbell, then producer must ring it
+  alignas(64) Flag consumerWaiting{1};
+  Flag consumerClosed{0};
+  // producer is parked on spaceSeq futex waiting for free space
+  alignas(64) Flag producerWaiting{0};
+  Flag spaceSeq{0};
+  uint64_t capacity = 0;
+};
+
+// Single producer, single consumer byte ring on a memfd
+class ShmRing {
+ public:
+  static constexpr size_t DefaultCapacity = 1024 * 1024;
+
+  ShmRing() = default;
+  ShmRing(const ShmRing &) = delete;
+  ShmRing &operator=(const ShmRing &) = delete;
+  ~ShmRing() { unmap(); }
+
+  // Producer side: allocate and initialize new shared memory
+  bool create(size_t capacity = DefaultCapacity) {
+    unmap();
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
+      MAF_LOGGER_ERROR("Ring capacity must be power of 2, got ", capacity);
+      return false;
+    }
+    if (fd_ = static_cast<FD>(syscall(SYS_memfd_create, "maf.shm.ring",
+                                      MFD_CLOEXEC));
+        fd_ == INVALID_FD) {
+      MAF_SOCKET_ERROR("Could not create memfd for shared memory ring");
+      return false;
+    }
+    auto size = sizeof(ShmRingHeader) + capacity;
+    if (ftruncate(fd_, static_cast<off_t>(size)) != 0 || !map(size)) {
+      MAF_SOCKET_ERROR("Could not allocate shared memory ring of ", size,
+                       " bytes");
+      fd_.reset();
+      return false;
+    }
+    header_ = new (base_) ShmRingHeader;
+    header_->capacity = capacity;
+    capacity_ = capacity;
+    return true;
+  }
+
+  // Consumer side: map the shared memory created by producer
+  bool attach(FD fd) {
+    unmap();
+    fd_ = fd;
+    struct stat st;
+    if (fstat(fd_, &st) != 0 ||
+        static_cast<size_t>(st.st_size) <= sizeof(ShmRingHeader) ||
+        !map(static_cast<size_t>(st.st_size))) {
+      MAF_SOCKET_ERROR("Could not map shared memory ring");
+      fd_.reset();
+      return false;
+    }
+    header_ = reinterpret_cast<ShmRingHeader *>(base_);
+    capacity_ = header_->capacity;
+    if (capacity_ == 0 || (capacity_ & (capacity_ - 1)) != 0 ||
+        capacity_ + sizeof(ShmRingHeader) > mappedSize_) {
+      MAF_LOGGER_ERROR("Shared memory ring has invalid capacity ", capacity_);
+      unmap();
+      return false;
+    }
+    return true;
+  }
+
+  void reset() { unmap(); }
+  bool valid() const { return header_ != nullptr; }
+  FD fd() { return fd_; }
+
+  // Producer: copies as many bytes as there's free space, returns that number
+  size_t write(const char *data, size_t length) {
+    auto head = header_->head.load(std::memory_order_relaxed);
+    auto tail = header_->tail.load(std::memory_order_acquire);
+    auto n = std::min(length, capacity_ - static_cast<size_t>(head - tail));
+    auto index = static_cast<size_t>(head) & (capacity_ - 1);
+    auto first = std::min(n, capacity_ - index);
+    memcpy(data_() + index, data, first);
+    memcpy(data_(), data + first, n - first);
+    header_->head.store(head + n, std::memory_order_seq_cst);
+    return n;
+  }
+
+  // Producer: true if consumer parked and must be woken up, the flag is
+  // consumed then doorbell is rung once per parking
+  bool takeConsumerWaiting() {
+    return header_->consumerWaiting.load(std::memory_order_seq_cst) != 0 &&
+           header_->consumerWaiting.exchange(0) != 0;
+  }
+
+  bool consumerClosed() const {
+    return header_->consumerClosed.load(std::memory_order_acquire) != 0;
+  }
+
+  // Producer: block until consumer frees some space or timeout
+  void waitForSpace(std::chrono::milliseconds timeout) {
+    auto seq = header_->spaceSeq.load(std::memory_order_seq_cst);
+    header_->producerWaiting.store(1, std::memory_order_seq_cst);
+    if (full()) {
+      timespec ts{static_cast<time_t>(timeout.count() / 1000),
+                  static_cast<long>((timeout.count() % 1000) * 1000000)};
+      syscall(SYS_futex, reinterpret_cast<uint32_t *>(&header_->spaceSeq),
+              FUTEX_WAIT, seq, &ts, nullptr, 0);
+    }
+    header_->producerWaiting.store(0, std::memory_order_relaxed);
+  }
+
+  // Consumer: hands every readable contiguous chunk to consume(data, length).
+  // Returns false if producer corrupted the positions.
+  template <class Consume>
+  bool read(Consume &&consume) {
+    auto tail = header_->tail.load(std::memory_order_relaxed);
+    auto head = header_->head.load(std::memory_order_acquire);
+    auto available = static_cast<size_t>(head - tail);
+    if (available > capacity_) {
+      return false;
+    }
+    if (available == 0) {
+      return true;
+    }
+
+    auto index = static_cast<size_t>(tail) & (capacity_ - 1);
+    auto first = std::min(available, capacity_ - index);
+    consume(data_() + index, first);
+    if (first < available) {
+      consume(data_(), available - first);
+    }
+
+    header_->tail.store(tail + available, std::memory_order_seq_cst);
+    if (header_->producerWaiting.load(std::memory_order_seq_cst) != 0) {
+      wakeProducer();
+    }
+    return true;
+  }
+
+  // Consumer: announce going to sleep, returns false if there're bytes came
+  // meanwhile then caller must read again instead of sleeping
+  bool park() {
+    header_->consumerWaiting.store(1, std::memory_order_seq_cst);
+    if (!empty()) {
+      header_->consumerWaiting.store(0, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  // Consumer: tell producer no one will read anymore
+  void close() {
+    if (valid()) {
+      header_->consumerClosed.store(1, std::memory_order_release);
+      wakeProducer();
+    }
+  }
+
+ private:
+  bool full() const {
+    return static_cast<size_t>(
+               header_->head.load(std::memory_order_relaxed) -
+               header_->tail.load(std::memory_order_seq_cst)) == capacity_;
+  }
+
+  bool empty() const {
+    return header_->head.load(std::memory_order_seq_cst) ==
+           header_->tail.load(std::memory_order_relaxed);
+  }
+
+  void wakeProducer() {
+    header_->spaceSeq.fetch_add(1, std::memory_order_seq_cst);
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&header_->spaceSeq),
+            FUTEX_WAKE, 1, nullptr, nullptr, 0);
+  }
+
+  bool map(size_t size) {
+    auto addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (addr == MAP_FAILED) {
+      return false;
+    }
+    base_ = static_cast<char *>(addr);
+    mappedSize_ = size;
+    return true;
+  }
+
+  void unmap() {
+    if (base_) {
+      munmap(base_, mappedSize_);
+    }
+    base_ = nullptr;
+    header_ = nullptr;
+    mappedSize_ = 0;
+    capacity_ = 0;
+    fd_.reset();
+  }
+
+  char *data_() { return base_ + sizeof(ShmRingHeader); }
+
+  AutoCloseFD<FD> fd_;
+  char *base_ = nullptr;
+  ShmRingHeader *header_ = nullptr;
+  size_t mappedSize_ = 0;
+  size_t capacity_ = 0;
+};
+
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
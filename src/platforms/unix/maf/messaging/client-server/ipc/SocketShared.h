@@ -3,10 +3,18 @@
 #include <error.h>
 #include <maf/logging/Logger.h>
 #include <maf/messaging/client-server/Address.h>
+#include <maf/utils/serialization/Buffer.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
 namespace maf {
 namespace messaging {
 namespace ipc {
@@ -16,7 +24,6 @@ using SocketPath = std::string;
 using FD = int;
 using SockFD = FD;
 
-static constexpr size_t MAXCLIENTS = 30;
 static constexpr SockFD INVALID_FD = -1;
 template <typename FileDescriptor, FD INVALID_VALUE = INVALID_FD>
 class AutoCloseFD {
@@ -92,6 +99,160 @@ inline AutoCloseFD<SockFD> connectToSocket(const std::string &sockpath) {
   return fd;
 }
 
+inline bool isBrokenConnectionError(int err) {
+  return err == EPIPE || err == ECONNRESET || err == ENOTCONN;
+}
+
+// Frames having this bit set in their length carry transport control data
+// instead of a message
+static constexpr SizeType CONTROL_FRAME_FLAG = SizeType{1} << 31;
+
+// How long a frame may wait for a peer that doesn't read
+static constexpr std::chrono::milliseconds SEND_TIMEOUT{1000};
+
+// Waits until a non-blocking socket can take more bytes, errno is ETIMEDOUT
+// if it cannot before deadline
+inline bool waitWritable(SockFD fd,
+                         std::chrono::steady_clock::time_point deadline) {
+  using namespace std::chrono;
+  pollfd pfd{fd, POLLOUT, 0};
+  int ready = 0;
+  do {
+    auto remain = ceil<milliseconds>(deadline - steady_clock::now());
+    auto timeoutMs = std::max(remain, milliseconds::zero()).count();
+    ready = poll(&pfd, 1, static_cast<int>(timeoutMs));
+  } while (ready == -1 && errno == EINTR);
+  if (ready == 0) {
+    errno = ETIMEDOUT;
+    return false;
+  }
+  return ready == 1 && !(pfd.revents & (POLLERR | POLLHUP | POLLNVAL));
+}
+
+// Frame layout on the stream: [SizeType payload length|flags][payload bytes]
+// A frame that cannot be written in timeout fails with ETIMEDOUT, it might
+// have been written partly then the connection is no longer usable
+inline bool sendFrame(SockFD fd, const srz::Buffer &payload,
+                      SizeType flags = 0,
+                      std::chrono::milliseconds timeout = SEND_TIMEOUT) {
+  if (payload.length() >= CONTROL_FRAME_FLAG) {
+    errno = EMSGSIZE;
+    return false;
+  }
+  auto payloadSize = static_cast<SizeType>(payload.length()) | flags;
+  iovec iov[2] = {
+      {reinterpret_cast<char *>(&payloadSize), sizeof(SizeType)},
+      {const_cast<char *>(payload.data()), payload.length()}};
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  auto remain = sizeof(SizeType) + payload.length();
+  while (remain > 0) {
+    // MSG_NOSIGNAL: a receiver that went away must not kill us with SIGPIPE
+    auto written = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if ((errno == EAGAIN || errno == EWOULDBLOCK) &&
+          waitWritable(fd, deadline)) {
+        continue;
+      }
+      return false;
+    }
+    remain -= static_cast<size_t>(written);
+    while (written > 0) {
+      if (static_cast<size_t>(written) >= msg.msg_iov->iov_len) {
+        written -= static_cast<ssize_t>(msg.msg_iov->iov_len);
+        ++msg.msg_iov;
+        --msg.msg_iovlen;
+      } else {
+        msg.msg_iov->iov_base =
+            static_cast<char *>(msg.msg_iov->iov_base) + written;
+        msg.msg_iov->iov_len -= static_cast<size_t>(written);
+        written = 0;
+      }
+    }
+  }
+  return true;
+}
+
+// Passes open file descriptors to the peer of a unix domain socket
+inline bool sendFileDescriptors(SockFD sock, const FD *fds, size_t count) {
+  constexpr size_t MaxFDs = 4;
+  if (count == 0 || count > MaxFDs) {
+    return false;
+  }
+  char data = 0;
+  iovec iov = {&data, sizeof(data)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(FD) * MaxFDs)];
+  memset(control, 0, sizeof(control));
+
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = CMSG_SPACE(sizeof(FD) * count);
+
+  auto cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(FD) * count);
+  memcpy(CMSG_DATA(cmsg), fds, sizeof(FD) * count);
+
+  ssize_t sent = 0;
+  do {
+    sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+  } while (sent == -1 && errno == EINTR);
+  return sent == sizeof(data);
+}
+
+// Receives file descriptors sent by sendFileDescriptors, returns number of
+// received ones, 0 if peer closed the connection or sent none and -1 on
+// error
+inline int receiveFileDescriptors(SockFD sock, FD *fds, size_t maxCount) {
+  constexpr size_t MaxFDs = 4;
+  char data = 0;
+  iovec iov = {&data, sizeof(data)};
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(FD) * MaxFDs)];
+
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  ssize_t received = 0;
+  do {
+    received = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC);
+  } while (received == -1 && errno == EINTR);
+  if (received <= 0) {
+    return static_cast<int>(received);
+  }
+
+  int count = 0;
+  for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+      auto n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(FD);
+      for (size_t i = 0; i < n; ++i) {
+        FD fd;
+        memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(FD), sizeof(FD));
+        if (static_cast<size_t>(count) < maxCount) {
+          fds[count++] = fd;
+        } else {
+          close(fd);
+        }
+      }
+    }
+  }
+  return count;
+}
+
 } // namespace ipc
 } // namespace messaging
 } // namespace maf
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <maf/messaging/client-server/CSStatus.h>
+
 #include "NamedPipeReceiverBase.h"
 
 namespace maf {
@@ -27,6 +29,10 @@ class LocalIPCBufferReceiverImpl : public NamedPipeReceiverBase {
   bool stop();
   void setObserver(BytesComeCallback &&);
   bool init(const Address &address);
+  // Pipes are one way, then there's no connection to send back on
+  ActionCallStatus sendBack(const srz::Buffer &, const Address &) {
+    return ActionCallStatus::ReceiverUnavailable;
+  }
 
  private:
   bool initPipes();
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "LocalIPCBufferReceiverImpl.h"
+#include "LocalIPCBufferSenderImpl.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace local {
+
+// Named pipes are one way, then server still connects back to the pipe this
+// client listens on
+class LocalIPCClientConnectionImpl {
+ public:
+  bool init(const Address &myAddr) { return receiver_.init(myAddr); }
+  bool start() { return receiver_.start(); }
+  void stop() { receiver_.stop(); }
+  void deinit() { receiver_.deinit(); }
+  bool running() const { return receiver_.running(); }
+  const Address &address() const { return receiver_.address(); }
+  void setObserver(BytesComeCallback callback) {
+    receiver_.setObserver(std::move(callback));
+  }
+
+  ActionCallStatus send(const maf::srz::Buffer &payload,
+                        const Address &serverAddr) {
+    return sender_.send(payload, serverAddr);
+  }
+  Availability checkReceiverStatus(const Address &serverAddr) const {
+    return sender_.checkReceiverStatus(serverAddr);
+  }
+
+ private:
+  LocalIPCBufferSenderImpl sender_;
+  LocalIPCBufferReceiverImpl receiver_;
+};
+
+}  // namespace local
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "LocalIPCBufferReceiverImpl.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+// Shared memory ring is not implemented on this platform yet, bytes go
+// through named pipes like local ipc
+class ShmIPCBufferReceiverImpl : public local::LocalIPCBufferReceiverImpl {};
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
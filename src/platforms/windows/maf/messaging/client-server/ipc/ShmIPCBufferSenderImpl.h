@@ -0,0 +1,17 @@
+#pragma once
+
+#include "LocalIPCBufferSenderImpl.h"
+
+namespace maf {
+namespace messaging {
+namespace ipc {
+namespace shm {
+
+// Shared memory ring is not implemented on this platform yet, bytes go
+// through named pipes like local ipc
+class ShmIPCBufferSenderImpl : public local::LocalIPCBufferSenderImpl {};
+
+}  // namespace shm
+}  // namespace ipc
+}  // namespace messaging
+}  // namespace maf
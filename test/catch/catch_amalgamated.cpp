@@ -3584,8 +3584,7 @@ struct SignalDefs {
 
 // 32kb for the alternate stack seems to be sufficient. However, this value
 // is experimentally determined, so that's not guaranteed.
-static constexpr std::size_t sigStackSize =
-    32768 >= MINSIGSTKSZ ? 32768 : MINSIGSTKSZ;
+static constexpr std::size_t sigStackSize = 32768;
 
 static SignalDefs signalDefs[] = {
     {SIGINT, "SIGINT - Terminal interrupt signal"},
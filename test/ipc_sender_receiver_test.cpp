@@ -2,12 +2,21 @@
 #include <maf/logging/Logger.h>
 #include <maf/threading/AtomicObject.h>
 
+#include <algorithm>
 #include <atomic>
+#include <map>
 #include <thread>
 #include <vector>
 
+#include "../src/common/maf/messaging/client-server/IncomingDispatcher.h"
 #include "../src/common/maf/messaging/client-server/ipc/LocalIPCBufferReceiver.h"
 #include "../src/common/maf/messaging/client-server/ipc/LocalIPCBufferSender.h"
+#include "../src/common/maf/messaging/client-server/ipc/LocalIPCClientConnection.h"
+#include "../src/common/maf/messaging/client-server/ipc/LocalIPCMessage.h"
+#include "../src/common/maf/messaging/client-server/ipc/LocalIPCServer.h"
+#include "../src/common/maf/messaging/client-server/ipc/ShmIPCBufferReceiver.h"
+#include "../src/common/maf/messaging/client-server/ipc/ShmIPCBufferSender.h"
+#include "../src/platforms/unix/maf/messaging/client-server/ipc/SocketShared.h"
 
 #define CATCH_CONFIG_MAIN
 #include "catch/catch_amalgamated.hpp"
@@ -73,3 +82,278 @@ TEST_CASE("Sender receiver test for library internal") {
   receiver.stop();
   receiverThread.join();
 }
+
+TEST_CASE("Receiver serves many connected senders and stops promptly") {
+  Address receiverAddr{"many.senders.nocpes.github.com", 0};
+  auto receiver = local::LocalIPCBufferReceiver{};
+  REQUIRE(receiver.init(receiverAddr));
+
+  std::atomic_size_t count = 0;
+  struct CountingObserver : public BytesComeObserver {
+    std::atomic_size_t* count;
+    CountingObserver(std::atomic_size_t* c) : count{c} {}
+    void onBytesCome(Buffer&&) override { ++(*count); }
+  } observer{&count};
+  receiver.setObserver(&observer);
+
+  auto receiverThread = std::thread{[&receiver] { receiver.start(); }};
+
+  // Each sender keeps its own connection to receiver
+  const auto SendersCount = size_t{100};
+  const auto MessagesPerSender = size_t{10};
+  std::vector<local::LocalIPCBufferSender> senders(SendersCount);
+  for (size_t i = 0; i < MessagesPerSender; ++i) {
+    for (auto& sender : senders) {
+      REQUIRE(sender.send(Buffer(i * 1000, 'x'), receiverAddr) ==
+              ActionCallStatus::Success);
+    }
+  }
+
+  for (int i = 0; i < 100 && count < SendersCount * MessagesPerSender; ++i) {
+    std::this_thread::sleep_for(10ms);
+  }
+  REQUIRE(count == SendersCount * MessagesPerSender);
+
+  auto stopBegin = std::chrono::steady_clock::now();
+  receiver.stop();
+  receiverThread.join();
+  REQUIRE(std::chrono::steady_clock::now() - stopBegin < 500ms);
+}
+
+TEST_CASE("Receiver can be started again after it is stopped") {
+  Address receiverAddr{"restart.nocpes.github.com", 0};
+  auto receiver = local::LocalIPCBufferReceiver{};
+  REQUIRE(receiver.init(receiverAddr));
+
+  std::atomic_size_t count = 0;
+  struct CountingObserver : public BytesComeObserver {
+    std::atomic_size_t* count;
+    CountingObserver(std::atomic_size_t* c) : count{c} {}
+    void onBytesCome(Buffer&&) override { ++(*count); }
+  } observer{&count};
+  receiver.setObserver(&observer);
+
+  for (size_t run = 1; run <= 3; ++run) {
+    auto receiverThread = std::thread{[&receiver] { receiver.start(); }};
+    auto sender = local::LocalIPCBufferSender{};
+    REQUIRE(sender.send("hello", receiverAddr) == ActionCallStatus::Success);
+    for (int i = 0; i < 100 && count < run; ++i) {
+      std::this_thread::sleep_for(10ms);
+    }
+    REQUIRE(count == run);
+    REQUIRE(receiver.running());
+
+    receiver.stop();
+    receiverThread.join();
+    REQUIRE_FALSE(receiver.running());
+  }
+}
+
+TEST_CASE("Sending back to a peer that never reads times out") {
+  Address receiverAddr{"never.reads.nocpes.github.com", 0};
+  auto receiver = local::LocalIPCBufferReceiver{};
+  REQUIRE(receiver.init(receiverAddr));
+  auto observer = WaitableBytesComeObserver{};
+  receiver.setObserver(&observer);
+  auto receiverThread = std::thread{[&receiver] { receiver.start(); }};
+
+  // Introduces itself as a multiplexed client then never reads
+  const Address peerAddr{"lazy.peer.nocpes.github.com", 0};
+  auto fd = connectToSocket(receiverAddr.get_name());
+  REQUIRE(static_cast<SockFD>(fd) != INVALID_FD);
+  REQUIRE(sendFrame(fd, peerAddr.get_name(), CONTROL_FRAME_FLAG));
+
+  const Buffer chunk(64 * 1024, 'x');
+  auto status = ActionCallStatus::ReceiverUnavailable;
+  for (int i = 0; i < 100 && status == ActionCallStatus::ReceiverUnavailable;
+       ++i) {
+    std::this_thread::sleep_for(1ms);
+    status = receiver.sendBack(chunk, peerAddr);
+  }
+  REQUIRE(status == ActionCallStatus::Success);
+
+  auto sendBegin = std::chrono::steady_clock::now();
+  for (int i = 0; i < 1000 && status == ActionCallStatus::Success; ++i) {
+    sendBegin = std::chrono::steady_clock::now();
+    status = receiver.sendBack(chunk, peerAddr);
+  }
+  REQUIRE(status == ActionCallStatus::Timeout);
+  REQUIRE(std::chrono::steady_clock::now() - sendBegin < SEND_TIMEOUT + 500ms);
+  // The peer is dropped, a partly written frame left its stream unusable
+  REQUIRE(receiver.sendBack(chunk, peerAddr) ==
+          ActionCallStatus::ReceiverUnavailable);
+
+  auto stopBegin = std::chrono::steady_clock::now();
+  receiver.stop();
+  receiverThread.join();
+  REQUIRE(std::chrono::steady_clock::now() - stopBegin < 500ms);
+}
+
+TEST_CASE("Shared memory sender keeps frames whole and in order") {
+  Address receiverAddr{"shm.nocpes.github.com", 0};
+  auto sender = shm::ShmIPCBufferSender{};
+  auto receiver = shm::ShmIPCBufferReceiver{};
+  REQUIRE(sender.checkReceiverStatus(receiverAddr) ==
+          Availability::Unavailable);
+  REQUIRE(receiver.init(receiverAddr));
+
+  struct CollectingObserver : public BytesComeObserver {
+    AtomicObject<std::vector<Buffer>> buffers;
+    void onBytesCome(Buffer&& buff) override {
+      buffers->push_back(std::move(buff));
+    }
+  } observer;
+  receiver.setObserver(&observer);
+
+  auto receiverThread = std::thread{[&receiver] { receiver.start(); }};
+  REQUIRE(sender.checkReceiverStatus(receiverAddr) == Availability::Available);
+
+  // Mix small frames with ones bigger than the ring itself
+  std::vector<Buffer> sentBuffers;
+  for (size_t i = 0; i < 50; ++i) {
+    auto size = i % 10 == 0 ? 3 * 1024 * 1024 + i : i * 100;
+    sentBuffers.emplace_back(size, static_cast<char>('a' + i % 26));
+  }
+  for (const auto& buffer : sentBuffers) {
+    REQUIRE(sender.send(buffer, receiverAddr) == ActionCallStatus::Success);
+  }
+
+  for (int i = 0; i < 200 && observer.buffers->size() < sentBuffers.size();
+       ++i) {
+    std::this_thread::sleep_for(10ms);
+  }
+  REQUIRE(*observer.buffers.atomic() == sentBuffers);
+
+  receiver.stop();
+  receiverThread.join();
+  REQUIRE(sender.send("late", receiverAddr) != ActionCallStatus::Success);
+}
+
+TEST_CASE("Client connection gets replies without listening") {
+  Address serverAddr{"mux.server.nocpes.github.com", 0};
+  Address clientAddr{"mux.client.nocpes.github.com", 0};
+
+  struct CollectingObserver : public BytesComeObserver {
+    AtomicObject<std::vector<Buffer>> buffers;
+    void onBytesCome(Buffer&& buff) override {
+      buffers->push_back(std::move(buff));
+    }
+  } serverObserver, clientObserver;
+
+  auto server = local::LocalIPCBufferReceiver{};
+  REQUIRE(server.init(serverAddr));
+  server.setObserver(&serverObserver);
+  auto serverThread = std::thread{[&server] { server.start(); }};
+
+  auto client = local::LocalIPCClientConnection{};
+  REQUIRE(client.init(clientAddr));
+  client.setObserver(&clientObserver);
+  auto clientThread = std::thread{[&client] { client.start(); }};
+
+  // Nobody listens on client address, server can't connect back
+  REQUIRE(local::LocalIPCBufferSender{}.checkReceiverStatus(clientAddr) ==
+          Availability::Unavailable);
+  REQUIRE(server.sendBack("too early", clientAddr) ==
+          ActionCallStatus::ReceiverUnavailable);
+
+  REQUIRE(client.checkReceiverStatus(serverAddr) == Availability::Available);
+  REQUIRE(client.send("request", serverAddr) == ActionCallStatus::Success);
+  for (int i = 0; i < 100 && serverObserver.buffers->empty(); ++i) {
+    std::this_thread::sleep_for(5ms);
+  }
+  REQUIRE(*serverObserver.buffers.atomic() == std::vector<Buffer>{"request"});
+
+  REQUIRE(server.sendBack("response", clientAddr) == ActionCallStatus::Success);
+  for (int i = 0; i < 100 && clientObserver.buffers->empty(); ++i) {
+    std::this_thread::sleep_for(5ms);
+  }
+  REQUIRE(*clientObserver.buffers.atomic() == std::vector<Buffer>{"response"});
+
+  // Losing server is reported once, then connection is made again
+  server.stop();
+  serverThread.join();
+  std::this_thread::sleep_for(10ms);
+  REQUIRE(client.checkReceiverStatus(serverAddr) ==
+          Availability::Unavailable);
+
+  client.stop();
+  clientThread.join();
+}
+
+TEST_CASE("Incoming dispatcher keeps order of messages with same key") {
+  const auto Sources = std::vector<Address>{
+      {"client.1", 0}, {"client.2", 0}, {"client.2", 1}, {"client.3", 0}};
+  const auto MessagesPerKey = size_t{1000};
+
+  std::map<incoming_dispatcher::ShardKey, std::vector<size_t>> handled;
+  for (const auto& source : Sources) {
+    handled[incoming_dispatcher::keyOf(source)];
+  }
+  REQUIRE(handled.size() == Sources.size());
+
+  std::atomic_size_t total = 0;
+  for (size_t i = 0; i < MessagesPerKey; ++i) {
+    for (auto& [key, sequence] : handled) {
+      incoming_dispatcher::submit(key, [i, &sequence = sequence, &total] {
+        sequence.push_back(i);
+        ++total;
+      });
+    }
+  }
+
+  for (int i = 0; i < 200 && total < MessagesPerKey * handled.size(); ++i) {
+    std::this_thread::sleep_for(5ms);
+  }
+  REQUIRE(total == MessagesPerKey * handled.size());
+  for (auto& [key, sequence] : handled) {
+    REQUIRE(std::is_sorted(sequence.begin(), sequence.end()));
+  }
+
+  // Workers are running, then their count can no longer change
+  auto count = incoming_dispatcher::workerCount();
+  REQUIRE_FALSE(incoming_dispatcher::setWorkerCount(count + 1));
+  REQUIRE(incoming_dispatcher::workerCount() == count);
+}
+
+TEST_CASE("Server writes one encoded broadcast to every client") {
+  auto server = std::make_shared<local::LocalIPCServer>();
+  server->setBroadcastWriterCount(2);
+  REQUIRE(server->init({"broadcast.server.nocpes.github.com", 0}));
+
+  struct CollectingObserver : public BytesComeObserver {
+    AtomicObject<std::vector<Buffer>> buffers;
+    void onBytesCome(Buffer&& buff) override {
+      buffers->push_back(std::move(buff));
+    }
+  };
+  const auto ClientsCount = size_t{5};
+  std::vector<Address> clientAddrs;
+  std::vector<local::LocalIPCBufferReceiver> clients(ClientsCount);
+  std::vector<CollectingObserver> observers(ClientsCount);
+  std::vector<std::thread> clientThreads;
+  for (size_t i = 0; i < ClientsCount; ++i) {
+    clientAddrs.emplace_back("broadcast.client." + std::to_string(i), 0);
+    REQUIRE(clients[i].init(clientAddrs.back()));
+    clients[i].setObserver(&observers[i]);
+    clientThreads.emplace_back([&client = clients[i]] { client.start(); });
+  }
+  clientAddrs.emplace_back("broadcast.client.gone", 0);
+
+  auto msg = std::make_shared<local::LocalIPCMessage>(
+      "broadcast.sid", "signal", OpCode::SignalRegister);
+  auto results = server->sendMessageToClients(msg, clientAddrs);
+  REQUIRE(results.size() == clientAddrs.size());
+  REQUIRE(results.back() == ActionCallStatus::ReceiverUnavailable);
+
+  const auto expectedBytes = msg->toBytes();
+  for (size_t i = 0; i < ClientsCount; ++i) {
+    REQUIRE(results[i] == ActionCallStatus::Success);
+    for (int wait = 0; wait < 100 && observers[i].buffers->empty(); ++wait) {
+      std::this_thread::sleep_for(5ms);
+    }
+    REQUIRE(*observers[i].buffers.atomic() ==
+            std::vector<Buffer>{expectedBytes});
+    clients[i].stop();
+    clientThreads[i].join();
+  }
+}
@@ -2,8 +2,10 @@
 #include <maf/messaging/Routing.h>
 #include <maf/utils/StringifyableEnum.h>
 
+#include <array>
 #include <atomic>
 #include <iostream>
+#include <thread>
 
 #define CATCH_CONFIG_MAIN
 #include "catch/catch_amalgamated.hpp"
@@ -252,3 +254,127 @@ TEST_CASE("sendMessage") {
 
   logic.stopAndWait();
 }
+
+TEST_CASE("broadcastDoesNotBlockRegistration") {
+  struct broadcast_msg {};
+  auto blocked = Processor::create("blocked", QueueOptions{1});
+  std::atomic_int handled = 0;
+  blocked->connect<broadcast_msg>([&handled] { ++handled; });
+
+  // Second broadcast waits for room in the full queue of blocked
+  std::thread broadcaster{[] {
+    routing::postToAll<broadcast_msg>();
+    routing::postToAll<broadcast_msg>();
+  }};
+  while (blocked->pendingCout() == 0) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(10ms);
+
+  auto newcomer = Processor::create("newcomer");
+  REQUIRE(newcomer);
+  REQUIRE(routing::findProcessor("newcomer") == newcomer);
+  REQUIRE(!Processor::create("newcomer"));
+
+  REQUIRE(blocked->runOnceFor(100ms));
+  REQUIRE(blocked->runOnceFor(100ms));
+  broadcaster.join();
+  REQUIRE(handled == 2);
+
+  newcomer->stop();
+  REQUIRE(!routing::findProcessor("newcomer"));
+  blocked->stop();
+}
+
+TEST_CASE("blockedStatusUpdateDoesNotBlockSubscription") {
+  struct later_msg {};
+  auto watcher = Processor::create("watcher", QueueOptions{1});
+  watcher->connect<routing::ProcessorStatusUpdateMsg>(
+      [](const routing::ProcessorStatusUpdateMsg &) {});
+  REQUIRE(watcher->executeAsync([] {}));
+
+  // Waits for room in the queue of watcher to tell it about joiner
+  ProcessorInstance joiner;
+  std::thread joining{[&joiner] { joiner = Processor::create("joiner"); }};
+  std::this_thread::sleep_for(10ms);
+
+  auto con = watcher->connect<later_msg>([] {});
+  REQUIRE(watcher->runOnceFor(100ms));
+  joining.join();
+  REQUIRE(joiner);
+  REQUIRE(watcher->runOnceFor(100ms));
+
+  joiner->stop();
+  watcher->stop();
+}
+
+TEST_CASE("broadcastToSubscribers") {
+  struct subscribed_msg {};
+  auto subscriber = Processor::create("subscriber");
+  auto bystander = Processor::create("bystander");
+  int handled = 0;
+
+  REQUIRE(!routing::postToAll<subscribed_msg>());
+  subscriber->connect<subscribed_msg>([&handled] { ++handled; });
+  // A second handler doesn't subscribe twice
+  subscriber->connect<subscribed_msg>([&handled] { ++handled; });
+  REQUIRE(routing::postToAll<subscribed_msg>());
+  REQUIRE(subscriber->pendingCout() == 1);
+  REQUIRE(bystander->pendingCout() == 0);
+  REQUIRE(subscriber->runOnceFor(10ms));
+  REQUIRE(handled == 2);
+
+  subscriber->disconnect<subscribed_msg>();
+  REQUIRE(!routing::postToAll<subscribed_msg>());
+  REQUIRE(subscriber->pendingCout() == 0);
+
+  // Leaving routing drops its subscriptions
+  subscriber->connect<subscribed_msg>([&handled] { ++handled; });
+  subscriber->stop();
+  subscriber->reuse();
+  REQUIRE(!routing::postToAll<subscribed_msg>());
+  REQUIRE(subscriber->pendingCout() == 0);
+
+  bystander->stop();
+}
+
+struct counted_msg {
+  static inline std::atomic_int copies = 0;
+  counted_msg() = default;
+  counted_msg(counted_msg &&) = default;
+  counted_msg(const counted_msg &) { ++copies; }
+  std::array<char, 256> payload = {};
+};
+
+TEST_CASE("broadcastSharesPayload") {
+  constexpr int ReceiversCount = 3;
+  std::vector<ProcessorInstance> receivers;
+  std::vector<const counted_msg *> received;
+  for (int i = 0; i < ReceiversCount; ++i) {
+    auto receiver = Processor::create("receiver" + std::to_string(i));
+    receiver->connect<counted_msg>(
+        [&received](const counted_msg &msg) { received.push_back(&msg); });
+    receivers.push_back(std::move(receiver));
+  }
+
+  REQUIRE(routing::postToAll<counted_msg>());
+  auto shared = makeSharedMessage<counted_msg>();
+  REQUIRE(routing::sendToAll(shared).valid());
+  for (int round = 0; round < 2; ++round) {
+    for (auto &receiver : receivers) {
+      REQUIRE(receiver->runOnceFor(10ms));
+    }
+  }
+  REQUIRE(received.size() == 2 * ReceiversCount);
+  REQUIRE(counted_msg::copies == 0);
+  // Every receiver got the same object, that of shared for sendToAll
+  auto sharedPayload = &std::any_cast<const counted_msg &>(shared.content());
+  for (int i = 0; i < ReceiversCount; ++i) {
+    REQUIRE(received[i] == received[0]);
+    REQUIRE(received[ReceiversCount + i] == sharedPayload);
+  }
+
+  for (auto &receiver : receivers) {
+    receiver->stop();
+  }
+}
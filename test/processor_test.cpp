@@ -258,3 +258,196 @@ TEST_CASE("blockingExecution") {
   REQUIRE(firedCount == 0);
   REQUIRE(gotException == true);
 }
+
+TEST_CASE("moveOnlyExecution") {
+  AsyncProcessor comp;
+  comp.launch();
+  auto value = std::make_unique<int>(10);
+  int received = 0;
+  comp->waitableExecute(
+          [value = std::move(value), &received] { received = *value; })
+      .wait();
+  REQUIRE(received == 10);
+  comp->stop();
+}
+
+TEST_CASE("batchExecution") {
+  auto processor = Processor::create();
+  processor->setMaxBatchSize(4);
+  std::vector<int> executed;
+  for (int i = 0; i < 10; ++i) {
+    processor->executeAsync([i, &executed] {
+      executed.push_back(i);
+      if (i == 5) {
+        this_processor::stop();
+      }
+    });
+  }
+  processor->run();
+
+  // Executions after the stop are dropped, even ones in the same batch
+  REQUIRE(executed == std::vector<int>{0, 1, 2, 3, 4, 5});
+  REQUIRE(processor->pendingCout() == 0);
+}
+
+TEST_CASE("boundedQueue") {
+  std::vector<int> executed;
+  auto record = [&executed](int i) {
+    return [i, &executed] { executed.push_back(i); };
+  };
+
+  SECTION("reject") {
+    auto processor = Processor::create({}, {3, OverflowPolicy::Reject});
+    for (int i = 0; i < 5; ++i) {
+      REQUIRE(processor->executeAsync(record(i)) == (i < 3));
+    }
+    processor->runFor(10ms);
+    REQUIRE(executed == std::vector<int>{0, 1, 2});
+  }
+
+  SECTION("drop_oldest") {
+    auto processor = Processor::create({}, {3, OverflowPolicy::DropOldest});
+    for (int i = 0; i < 5; ++i) {
+      REQUIRE(processor->executeAsync(record(i)));
+    }
+    processor->runFor(10ms);
+    REQUIRE(executed == std::vector<int>{2, 3, 4});
+  }
+
+  SECTION("conflate") {
+    auto processor = Processor::create({}, {2, OverflowPolicy::Conflate});
+    auto con = processor->connect<int>(
+        [&executed](const int& i) { executed.push_back(i); });
+    for (int i = 0; i < 5; ++i) {
+      REQUIRE(processor->post<int>(i));
+    }
+    REQUIRE(processor->pendingCout() == 1);
+    REQUIRE(processor->executeAsync(record(10)));
+    REQUIRE_FALSE(processor->executeAsync(record(11)));
+    processor->runFor(10ms);
+    REQUIRE(executed == std::vector<int>{4, 10});
+
+    // A conflated message dropped by stop does not hold back later ones
+    REQUIRE(processor->post<int>(5));
+    processor->stop();
+    processor->reuse();
+    REQUIRE(processor->post<int>(6));
+    REQUIRE(processor->pendingCout() == 1);
+    processor->runFor(10ms);
+    REQUIRE(executed == std::vector<int>{4, 10, 6});
+  }
+
+  SECTION("block") {
+    constexpr size_t Capacity = 2;
+    auto processor = Processor::create({}, {Capacity, OverflowPolicy::Block});
+    size_t maxPending = 0;
+    std::thread producer{[&] {
+      for (int i = 0; i < 100; ++i) {
+        processor->executeAsync([&, i] {
+          maxPending = std::max(maxPending, processor->pendingCout());
+          executed.push_back(i);
+        });
+      }
+    }};
+    processor->runFor(100ms);
+    producer.join();
+    REQUIRE(executed.size() == 100);
+    REQUIRE(maxPending <= Capacity);
+  }
+
+  SECTION("watermarks") {
+    int highCount = 0;
+    int lowCount = 0;
+    QueueOptions options;
+    options.highWatermark = 3;
+    options.lowWatermark = 1;
+    options.onHighWatermark = [&highCount] { ++highCount; };
+    options.onLowWatermark = [&lowCount] { ++lowCount; };
+    auto processor = Processor::create({}, std::move(options));
+    processor->setMaxBatchSize(1);
+    for (int i = 0; i < 5; ++i) {
+      processor->executeAsync(record(i));
+    }
+    REQUIRE(highCount == 1);
+    REQUIRE(lowCount == 0);
+    processor->runFor(10ms);
+    REQUIRE(highCount == 1);
+    REQUIRE(lowCount == 1);
+  }
+}
+
+TEST_CASE("priorityLanes") {
+  std::vector<std::string> executed;
+  auto record = [&executed](std::string name) {
+    return [name = std::move(name), &executed] { executed.push_back(name); };
+  };
+
+  SECTION("strict") {
+    auto processor = Processor::create();
+    processor->executeAsync(record("background"), Priority::Background);
+    processor->executeAsync(record("normal"));
+    processor->executeAsync(record("urgent"), Priority::Urgent);
+    processor->executeAsync(record("urgent.2"), Priority::Urgent);
+    processor->runFor(10ms);
+    REQUIRE(executed == std::vector<std::string>{"urgent", "urgent.2",
+                                                 "normal", "background"});
+  }
+
+  SECTION("weighted") {
+    QueueOptions options;
+    options.priorityWeight = 2;
+    auto processor = Processor::create({}, std::move(options));
+    for (int i = 0; i < 2; ++i) {
+      processor->executeAsync(record("background"), Priority::Background);
+    }
+    auto con = processor->connect<std::string>(
+        [&executed](const std::string& s) { executed.push_back(s); });
+    for (int i = 0; i < 4; ++i) {
+      processor->post(std::string{"normal"});
+    }
+    processor->runFor(10ms);
+    REQUIRE(executed ==
+            std::vector<std::string>{"normal", "normal", "background",
+                                     "normal", "normal", "background"});
+  }
+}
+
+TEST_CASE("processorMetrics") {
+  REQUIRE(DurationHistogram::bucketOf(0us) == 0);
+  REQUIRE(DurationHistogram::bucketOf(1us) == 1);
+  REQUIRE(DurationHistogram::bucketOf(3us) == 2);
+  REQUIRE(DurationHistogram::bucketOf(1h) == DurationHistogram::BucketCount - 1);
+
+  auto processor = Processor::create();
+  auto con = processor->connect<int>(
+      [](const int&) { std::this_thread::sleep_for(1ms); });
+
+  processor->post<int>(0);
+  processor->runFor(5ms);
+  REQUIRE(processor->metrics().executions == 0);
+
+  processor->setMetricsEnabled(true);
+  for (int i = 0; i < 3; ++i) {
+    processor->post<int>(i);
+  }
+  processor->executeAsync([] {});
+  REQUIRE(processor->metrics().queueDepth == 4);
+  processor->runFor(20ms);
+
+  auto metrics = processor->metrics();
+  REQUIRE(metrics.queueDepth == 0);
+  REQUIRE(metrics.peakQueueDepth == 4);
+  REQUIRE(metrics.executions == 4);
+  REQUIRE(metrics.executionsPerSecond > 0);
+  REQUIRE(metrics.queueLatency.count == 4);
+  REQUIRE(metrics.handlerTimes.size() == 1);
+  auto& handlerTime = metrics.handlerTimes.at(msgid<int>());
+  REQUIRE(handlerTime.count == 3);
+  REQUIRE(handlerTime.mean() >= 1ms);
+  REQUIRE(handlerTime.percentile(0.5) >= 1ms);
+  REQUIRE(handlerTime.percentile(1) == handlerTime.max);
+
+  processor->setMetricsEnabled(true);
+  REQUIRE(processor->metrics().executions == 0);
+  REQUIRE(processor->metrics().handlerTimes.at(msgid<int>()).count == 0);
+}
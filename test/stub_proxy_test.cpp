@@ -2,6 +2,8 @@
 #include <maf/ITCStub.h>
 #include <maf/LocalIPCProxy.h>
 #include <maf/LocalIPCStub.h>
+#include <maf/ShmIPCProxy.h>
+#include <maf/ShmIPCStub.h>
 #include <maf/Messaging.h>
 #include <maf/logging/Logger.h>
 #include <maf/messaging/client-server/ServiceStatusSignal.h>
@@ -10,6 +12,7 @@
 #include <maf/utils/TimeMeasurement.h>
 
 #include <algorithm>
+#include <atomic>
 #include <future>
 #include <iostream>
 #include <map>
@@ -78,6 +81,7 @@ ENDPROPERTY(not_set)
 using namespace maf::messaging;
 using namespace maf::util;
 namespace localipc = maf::localipc;
+namespace shmipc = maf::shmipc;
 namespace itc = maf::itc;
 using namespace std::chrono_literals;
 
@@ -109,7 +113,6 @@ class Tester {
 
     auto stub = stub_->with(serverProcessor()->getExecutor());
     auto proxy = proxy_->with(maf::util::directExecutor());
-    Availability serviceStatus;
     stub->template registerRequestHandler<string_request::input>(
         [](Request<string_request::input> request) {
           auto input = request.getInput();
@@ -166,12 +169,20 @@ class Tester {
 
     stub_->startServing();
 
-    std::promise<void> serviceStatusSource;
-    auto ftServiceStatusChangedSignal = serviceStatusSource.get_future();
+    // Status might still change while tearing down, then the callback must
+    // not refer to this frame
+    auto serviceStatus =
+        std::make_shared<std::atomic<Availability>>(Availability::Unknown);
+    auto serviceStatusSource = std::make_shared<std::promise<void>>();
+    auto ftServiceStatusChangedSignal = serviceStatusSource->get_future();
     proxy->onServiceStatusChanged(
-        [&serviceStatus, &serviceStatusSource](auto, Availability newStatus) {
-          serviceStatus = newStatus;
-          serviceStatusSource.set_value();
+        [serviceStatus, serviceStatusSource](auto,
+                                             Availability newStatus) mutable {
+          *serviceStatus = newStatus;
+          if (serviceStatusSource) {
+            serviceStatusSource->set_value();
+            serviceStatusSource.reset();
+          }
         });
 
     serviceStatusSignal(proxy)->waitIfNot(Availability::Available);
@@ -184,7 +195,7 @@ class Tester {
     SECTION("service_status") {
       REQUIRE(ftServiceStatusChangedSignal.wait_for(10ms) ==
               std::future_status::ready);
-      REQUIRE(serviceStatus == Availability::Available);
+      REQUIRE(*serviceStatus == Availability::Available);
     }
 
     SECTION("request_response_string") {
@@ -431,7 +442,7 @@ class Tester {
     }
 
     SECTION("service_status") {
-      REQUIRE(serviceStatus == Availability::Unavailable);
+      REQUIRE(*serviceStatus == Availability::Unavailable);
     }
 
     SECTION("server_side_notification") {
@@ -522,6 +533,18 @@ TEST_CASE("local.ipc.test") {
   tester.test();
 }
 
+TEST_CASE("shm.ipc.test") {
+  using namespace shmipc;
+  Address addr{"maf.request_response_test.shm", 0};
+  auto stub = createStub(addr, ServiceIDTest);
+  while (!stub) {
+    std::this_thread::sleep_for(10ms);
+    stub = createStub(addr, ServiceIDTest);
+  };
+  Tester<shmipc::ParamTrait> tester{stub, createProxy(addr, ServiceIDTest)};
+  tester.test();
+}
+
 TEST_CASE("itc.test") {
   using namespace itc;
   Tester<itc::ParamTrait> tester{createStub(ServiceIDTest),
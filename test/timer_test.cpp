@@ -1,9 +1,16 @@
 #include <maf/messaging/Processor.h>
 #include <maf/messaging/SignalTimer.h>
+#include <maf/messaging/SyncTimer.h>
 #include <maf/messaging/Timer.h>
 #include <maf/utils/TimeMeasurement.h>
 
+#include <algorithm>
+#include <atomic>
+#include <future>
 #include <iostream>
+#include <random>
+
+#include "../src/common/maf/messaging/TimingWheel.h"
 
 #define CATCH_CONFIG_MAIN
 #include "catch/catch_amalgamated.hpp"
@@ -147,8 +154,236 @@ TEST_CASE("messageprocessorCorrectness") {
     }
 
     t.setCyclic(true);
-    t.start(10ms, [] { this_processor::stop(); });
+    // Only a guard, timers are not queued behind pending executions
+    t.start(5s, [] { this_processor::stop(); });
   });
 
   REQUIRE(executedCount == totalExecutions);
 }
+
+TEST_CASE("timingWheel") {
+  using maf::messaging::details::TimingWheel;
+  struct Record : TimingWheel::Node {
+    uint64_t due = 0;
+    uint64_t firedAt = TimingWheel::NoTick;
+  };
+
+  TimingWheel wheel;
+  REQUIRE(wheel.nextTick() == TimingWheel::NoTick);
+
+  // Cover every level and expiries beyond the wheel span
+  std::mt19937_64 random{2020};
+  std::vector<Record> records(5000);
+  for (auto& r : records) {
+    auto level = random() % (TimingWheel::LevelCount + 1);
+    r.due = 1 + random() % (uint64_t{1} << (TimingWheel::SlotBits * level + 1));
+    wheel.insert(r, r.due);
+  }
+  for (size_t i = 0; i < records.size(); i += 3) {
+    wheel.remove(records[i]);
+  }
+  REQUIRE(wheel.size() == records.size() - (records.size() + 2) / 3);
+
+  uint64_t lastFired = 0;
+  auto onExpired = [&](TimingWheel::Node& node) {
+    auto& r = static_cast<Record&>(node);
+    r.firedAt = wheel.now();
+    REQUIRE(r.firedAt >= lastFired);
+    lastFired = r.firedAt;
+  };
+  // Big irregular steps, the wheel must jump over empty ticks by itself
+  for (uint64_t tick = 0; !wheel.empty(); tick += 1 + random() % 100000) {
+    wheel.advance(tick, onExpired);
+  }
+  for (size_t i = 0; i < records.size(); ++i) {
+    auto expected = i % 3 == 0 ? TimingWheel::NoTick : records[i].due;
+    REQUIRE(records[i].firedAt == expected);
+  }
+}
+
+TEST_CASE("manyTimersStopAndRestart") {
+  constexpr int TimersCount = 20000;
+  std::vector<Timer> timers(TimersCount);
+  int fired = 0;
+  Timer stopper;
+  maf::util::TimeMeasurement tm;
+  Processor::create()->run([&] {
+    for (int i = 0; i < TimersCount; ++i) {
+      timers[i].start(5 + i % 20, [&fired] { ++fired; });
+    }
+    // Keep only each tenth one, restart the rest of them once
+    for (int i = 0; i < TimersCount; ++i) {
+      if (i % 10 != 0) {
+        timers[i].stop();
+      } else {
+        timers[i].restart();
+      }
+    }
+    stopper.start(40, [] { this_processor::stop(); });
+  });
+
+  REQUIRE(fired == TimersCount / 10);
+  REQUIRE(std::none_of(timers.begin(), timers.end(),
+                       [](const Timer& t) { return t.running(); }));
+}
+
+TEST_CASE("timersDispatchedByProcessorLoop") {
+  auto processor = Processor::create();
+  Timer timer{true};
+  int hits = 0;
+  size_t maxPending = 0;
+  processor->run([&] {
+    timer.start(2, [&] {
+      // Expiries are not queued as executions
+      maxPending = std::max(maxPending, processor->pendingCout());
+      if (++hits == 3) {
+        this_processor::stop();
+      }
+    });
+    REQUIRE(processor->pendingCout() == 0);
+  });
+  REQUIRE(hits == 3);
+  REQUIRE(maxPending == 0);
+
+  // An expiry ends runOnceFor as an execution would
+  processor->reuse();
+  timer.setCyclic(false);
+  int expired = 0;
+  processor->executeAsync([&] { timer.start(5, [&expired] { ++expired; }); });
+  REQUIRE(processor->runOnceFor(100ms));
+  TimeMeasurement tm;
+  REQUIRE(processor->runOnceFor(100ms));
+  REQUIRE(expired == 1);
+  REQUIRE(tm.elapsedTime() < 50ms);
+}
+
+TEST_CASE("timerExpiringAfterStopFiresOnReuse") {
+  auto processor = Processor::create();
+  Timer stopper;
+  Timer timer;
+  int expired = 0;
+  processor->run([&] {
+    // Both are due at the same tick, stopper is handled first
+    stopper.start(5, [] { this_processor::stop(); });
+    timer.start(5, [&expired] { ++expired; });
+  });
+  REQUIRE(expired == 0);
+  REQUIRE(timer.running());
+
+  processor->reuse();
+  TimeMeasurement tm;
+  REQUIRE(processor->runOnceFor(100ms));
+  REQUIRE(expired == 1);
+  REQUIRE_FALSE(timer.running());
+  REQUIRE(tm.elapsedTime() < 50ms);
+}
+
+TEST_CASE("timerSlackCoalescing") {
+  constexpr int TimersCount = 100;
+  constexpr auto Slack = 30ms;
+  std::vector<Timer> timers(TimersCount);
+  std::vector<steady_clock::duration> firedAfter(TimersCount);
+  int fired = 0;
+  auto start = steady_clock::now();
+  Processor::create()->run([&] {
+    start = steady_clock::now();
+    for (int i = 0; i < TimersCount; ++i) {
+      timers[i].start(milliseconds{10 + i % 21}, Slack, [&, i] {
+        firedAfter[i] = steady_clock::now() - start;
+        if (++fired == TimersCount) {
+          this_processor::stop();
+        }
+      });
+    }
+  });
+
+  auto sorted = firedAfter;
+  std::sort(sorted.begin(), sorted.end());
+  int wakeups = 1;
+  for (size_t i = 1; i < sorted.size(); ++i) {
+    wakeups += sorted[i] - sorted[i - 1] > 500us;
+  }
+  // Without slack they would expire at 21 different ticks
+  REQUIRE(wakeups <= 3);
+  for (int i = 0; i < TimersCount; ++i) {
+    REQUIRE(firedAfter[i] >= milliseconds{10 + i % 21});
+    REQUIRE(firedAfter[i] < milliseconds{10 + i % 21} + Slack + 20ms);
+  }
+}
+
+TEST_CASE("syncTimerService") {
+  struct CountingExecutor : ExecutorIF {
+    std::atomic_int executed = 0;
+    bool execute(CallbackType callback) noexcept override {
+      ++executed;
+      callback();
+      return true;
+    }
+  };
+
+  SECTION("start_does_not_block") {
+    constexpr int TimersCount = 50;
+    std::vector<SyncTimer> timers(TimersCount);
+    std::atomic_int fired = 0;
+    std::promise<std::thread::id> serviceThread;
+    TimeMeasurement tm;
+    for (auto &timer : timers) {
+      timer.start(20ms, [&] {
+        if (++fired == TimersCount) {
+          serviceThread.set_value(std::this_thread::get_id());
+        }
+      });
+    }
+    REQUIRE(tm.elapsedTime() < 20ms);
+    auto firedOn = serviceThread.get_future();
+    REQUIRE(firedOn.wait_for(1s) == std::future_status::ready);
+    REQUIRE(firedOn.get() != std::this_thread::get_id());
+    REQUIRE(fired == TimersCount);
+    for (auto &timer : timers) {
+      REQUIRE(!timer.running());
+    }
+  }
+
+  SECTION("stop_cancels_callback") {
+    std::atomic_bool fired = false;
+    SyncTimer timer;
+    timer.start(10ms, [&] { fired = true; });
+    REQUIRE(timer.running());
+    timer.stop();
+    REQUIRE(!timer.running());
+    std::this_thread::sleep_for(30ms);
+    REQUIRE(!fired);
+  }
+
+  SECTION("cyclic_stops_itself") {
+    SyncTimer timer{true};
+    std::atomic_int hits = 0;
+    std::promise<void> done;
+    timer.start(2ms, [&] {
+      if (++hits == 5) {
+        timer.stop();
+        done.set_value();
+      }
+    });
+    REQUIRE(done.get_future().wait_for(1s) == std::future_status::ready);
+    std::this_thread::sleep_for(10ms);
+    REQUIRE(hits == 5);
+    REQUIRE(!timer.running());
+  }
+
+  SECTION("posted_to_executor") {
+    auto executor = std::make_shared<CountingExecutor>();
+    std::promise<void> done;
+    SyncTimer timer;
+    timer.start(5ms, [&] { done.set_value(); }, executor);
+    REQUIRE(done.get_future().wait_for(1s) == std::future_status::ready);
+    REQUIRE(executor->executed == 1);
+  }
+
+  SECTION("static_timer_stopped_at_exit") {
+    // Destroyed during static destruction while still running
+    static SyncTimer timer;
+    timer.start(1h, [] {});
+    REQUIRE(timer.running());
+  }
+}
@@ -1,11 +1,23 @@
 #include <maf/threading/AtomicObject.h>
+#include <maf/threading/CopyOnWrite.h>
+#include <maf/threading/Future.h>
+#include <maf/threading/MPSCQueue.h>
+#include <maf/threading/Task.h>
 #include <maf/threading/MutexRef.h>
+#include <maf/threading/Queue.h>
+#include <maf/threading/ThreadPoolFactory.h>
+#include <maf/threading/ThreadPoolImplBase.h>
 #include <maf/utils/cppextension/AggregateCompare.h>
 #include <maf/utils/cppextension/TypeTraits.h>
 #include <maf/utils/serialization/AggregateDump.h>
 #include <maf/utils/serialization/Dumper.h>
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <mutex>
+#include <stdexcept>
+#include <thread>
 
 #define CATCH_CONFIG_MAIN
 
@@ -76,4 +88,568 @@ TEST_CASE("AtomicObject_test") {
   sptr->append("hello world");
 }
 
+TEST_CASE("MPSCQueue_test") {
+  using namespace maf::threading;
+  using namespace std::chrono_literals;
+  constexpr size_t ProducersCount = 8;
+  constexpr size_t ItemsPerProducer = 10000;
+
+  // Small segments to make producers switch segments often
+  MPSCQueue<std::pair<size_t, size_t>, 7> queue;
+  std::pair<size_t, size_t> item;
+  REQUIRE_FALSE(queue.waitFor(item, 1ms));
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < ProducersCount; ++p) {
+    producers.emplace_back([&queue, p] {
+      for (size_t i = 0; i < ItemsPerProducer; ++i) {
+        queue.push({p, i});
+      }
+    });
+  }
+
+  // Items of one producer come out in the order they were pushed
+  std::vector<size_t> nextOf(ProducersCount, 0);
+  size_t received = 0;
+  while (received < ProducersCount * ItemsPerProducer && queue.wait(item)) {
+    REQUIRE(item.second == nextOf[item.first]++);
+    ++received;
+  }
+  for (auto& th : producers) {
+    th.join();
+  }
+  REQUIRE(received == ProducersCount * ItemsPerProducer);
+  REQUIRE(queue.empty());
+
+  std::thread closer{[&queue] {
+    std::this_thread::sleep_for(10ms);
+    queue.close();
+  }};
+  REQUIRE_FALSE(queue.wait(item));
+  closer.join();
+  REQUIRE_FALSE(queue.push({0, 0}));
+
+  queue.reOpen();
+  for (size_t i = 0; i < 10; ++i) {
+    REQUIRE(queue.push({1, i}));
+  }
+  REQUIRE(queue.size() == 10);
+  std::vector<std::pair<size_t, size_t>> batch;
+  REQUIRE(queue.waitBatch(batch, 8));
+  REQUIRE(batch.size() == 8);
+  REQUIRE(batch.back().second == 7);
+  queue.clear();
+  REQUIRE(queue.empty());
+}
+
+TEST_CASE("PriorityMPSCQueue_test") {
+  using namespace maf::threading;
+  PriorityMPSCQueue<int, 3, 3> queue;
+  for (int i = 0; i < 4; ++i) {
+    REQUIRE(queue.push(20 + i, 2));
+    REQUIRE(queue.push(10 + i, 1));
+  }
+  REQUIRE(queue.push(0, 0));
+  REQUIRE(queue.size() == 9);
+
+  std::vector<int> served;
+  REQUIRE(queue.waitBatch(served, 5));
+  REQUIRE(served == std::vector<int>{0, 10, 11, 12, 13});
+
+  // Lowest lane is dropped first
+  REQUIRE(queue.dropOldest());
+  REQUIRE_FALSE(queue.tryPush(1, 3, 0));
+  REQUIRE(queue.tryPush(1, 4, 0));
+
+  // Higher lane yields once to a waiting lower lane after 2 turns
+  queue.setLaneWeight(2);
+  for (int i = 2; i < 5; ++i) {
+    REQUIRE(queue.push(int{i}, 0));
+  }
+  served.clear();
+  REQUIRE(queue.waitBatch(served, 10));
+  REQUIRE(served == std::vector<int>{1, 2, 21, 3, 4, 22, 23});
+
+  // With every lane busy the lowest one still gets its turns
+  PriorityMPSCQueue<int, 3> busyQueue;
+  busyQueue.setLaneWeight(2);
+  for (int i = 0; i < 100; ++i) {
+    for (int lane = 0; lane < 3; ++lane) {
+      REQUIRE(busyQueue.push(lane * 100 + i, lane));
+    }
+  }
+  served.clear();
+  REQUIRE(busyQueue.waitBatch(served, 27));
+  std::vector<int> lanes;
+  for (auto value : served) {
+    lanes.push_back(value / 100);
+  }
+  REQUIRE(std::vector<int>(lanes.begin(), lanes.begin() + 9) ==
+          std::vector<int>{0, 0, 1, 0, 0, 1, 0, 0, 2});
+  REQUIRE(std::count(lanes.begin(), lanes.end(), 2) == 3);
+  REQUIRE(std::count(lanes.begin(), lanes.end(), 1) == 6);
+}
+
+TEST_CASE("Task_test") {
+  using namespace maf::threading;
+  struct Small {
+    std::shared_ptr<int> counter;
+    void operator()() { ++*counter; }
+  };
+  struct Big : Small {
+    char padding[256] = {};
+  };
+  static_assert(Task::fitsInline<Small>());
+  static_assert(!Task::fitsInline<Big>());
+  static_assert(sizeof(Task) == 128);
+
+  auto counter = std::make_shared<int>(0);
+  Task small = Small{counter};
+  Task big = Big{{counter}};
+  REQUIRE(counter.use_count() == 3);
+
+  Task moved = std::move(small);
+  REQUIRE_FALSE(small);
+  moved();
+  big();
+  REQUIRE(*counter == 2);
+
+  moved = std::move(big);
+  REQUIRE(counter.use_count() == 2);
+  moved = nullptr;
+  REQUIRE(counter.use_count() == 1);
+
+  REQUIRE_FALSE(Task{std::function<void()>{}});
+  REQUIRE_THROWS_AS(Task{}(), std::bad_function_call);
+}
+
+TEST_CASE("CopyOnWrite_test") {
+  using namespace maf::threading;
+  CopyOnWrite<std::vector<int>> values{size_t{3}, 3};
+  REQUIRE(values.read()->size() == 3);
+
+  // Readers always see a whole value: every element equals the size
+  std::atomic_bool done = false;
+  std::atomic_size_t badReads = 0;
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r) {
+    readers.emplace_back([&] {
+      while (!done) {
+        auto snapshot = values.read();
+        for (auto v : *snapshot) {
+          if (v != static_cast<int>(snapshot->size())) {
+            ++badReads;
+          }
+        }
+      }
+    });
+  }
+  for (int i = 1; i <= 1000; ++i) {
+    values.update([i](auto& v) { v.assign(static_cast<size_t>(i), i); });
+  }
+  done = true;
+  for (auto& th : readers) {
+    th.join();
+  }
+  REQUIRE(badReads == 0);
+  REQUIRE(values.read()->size() == 1000);
+}
+
+TEST_CASE("Future_test") {
+  using namespace maf::threading;
+  struct QueuedExecutor : util::ExecutorIF {
+    std::vector<CallbackType> callbacks;
+    bool execute(CallbackType callback) noexcept override {
+      callbacks.push_back(std::move(callback));
+      return true;
+    }
+  };
+
+  SECTION("then_runs_when_value_is_set") {
+    Promise<int> promise;
+    bool called = false;
+    auto doubled = promise.getFuture()
+                       .then([](int v) { return v * 2; })
+                       .then([&called](int v) {
+                         called = true;
+                         return std::to_string(v);
+                       });
+    REQUIRE(!called);
+    promise.setValue(21);
+    REQUIRE(called);
+    REQUIRE(doubled.ready());
+    REQUIRE(*doubled.get() == "42");
+  }
+
+  SECTION("broken_promise") {
+    Future<void> next;
+    bool called = false;
+    {
+      Promise<void> promise;
+      next = promise.getFuture().then([&called] { called = true; });
+    }
+    REQUIRE(next.ready());
+    REQUIRE_THROWS_AS(next.get(), std::future_error);
+    REQUIRE(!called);
+  }
+
+  SECTION("exception_is_propagated") {
+    Promise<int> promise;
+    bool called = false;
+    auto next = promise.getFuture().then([&called](int v) {
+      called = true;
+      return v;
+    });
+    promise.setException(
+        std::make_exception_ptr(std::runtime_error{"failed"}));
+    REQUIRE(!called);
+    REQUIRE_THROWS_AS(next.get(), std::runtime_error);
+
+    Promise<void> other;
+    auto thrown = other.getFuture().then([]() -> int {
+      throw std::runtime_error{"failed"};
+    });
+    other.setValue();
+    REQUIRE(thrown.ready());
+    REQUIRE_THROWS_AS(thrown.get(), std::runtime_error);
+  }
+
+  SECTION("then_on_executor") {
+    auto executor = std::make_shared<QueuedExecutor>();
+    Promise<int> promise;
+    auto next =
+        promise.getFuture().then(executor, [](int v) { return v + 1; });
+    promise.setValue(1);
+    REQUIRE(executor->callbacks.size() == 1);
+    REQUIRE(!next.ready());
+    executor->callbacks.front()();
+    REQUIRE(*next.get() == 2);
+  }
+
+  SECTION("wait_across_threads") {
+    Promise<int> promise;
+    auto future = promise.getFuture();
+    REQUIRE(future.waitFor(std::chrono::milliseconds{1}) ==
+            std::future_status::timeout);
+    std::thread setter{[&promise] { promise.setValue(7); }};
+    // A continuation attached after a timed out wait still runs
+    auto next = future.then([](int v) { return v; });
+    next.wait();
+    setter.join();
+    REQUIRE(*next.get() == 7);
+  }
+
+  SECTION("when_all") {
+    std::vector<Promise<int>> promises(3);
+    std::vector<Future<int>> futures;
+    for (auto& p : promises) {
+      futures.push_back(p.getFuture());
+    }
+    int sum = 0;
+    auto all = whenAll(std::move(futures)).then([&sum](auto futures) {
+      for (auto& f : futures) {
+        sum += *f.get();
+      }
+    });
+    promises[2].setValue(3);
+    promises[0].setValue(1);
+    REQUIRE(!all.ready());
+    promises[1].setValue(2);
+    REQUIRE(all.ready());
+    REQUIRE(sum == 6);
+    REQUIRE(whenAll(std::vector<Future<void>>{}).ready());
+  }
+
+  SECTION("when_any") {
+    std::vector<Promise<void>> promises(3);
+    std::vector<Future<void>> futures;
+    for (auto& p : promises) {
+      futures.push_back(p.getFuture());
+    }
+    auto any = whenAny(std::move(futures));
+    REQUIRE(!any.ready());
+    promises[1].setValue();
+    promises[0].setValue();
+    auto result = any.get();
+    REQUIRE(result->index == 1);
+    REQUIRE(result->futures[0].ready());
+    REQUIRE_NOTHROW(result->futures[1].get());
+    REQUIRE(!result->futures[2].ready());
+    promises[2] = Promise<void>{};
+    REQUIRE_THROWS_AS(result->futures[2].get(), std::future_error);
+  }
+}
+
+TEST_CASE("WorkStealingThreadPool_test") {
+  using namespace maf::threading;
+  auto pool = ThreadPoolFactory::createPool(WorkStealing, 4);
+  auto executor = std::dynamic_pointer_cast<util::ExecutorIF>(pool);
+  REQUIRE(executor);
+  REQUIRE(pool->activeThreadCount() == 4);
+
+  SECTION("runs_nested_submissions") {
+    constexpr int outer = 100;
+    constexpr int inner = 50;
+    std::atomic_int executed = 0;
+    Promise<void> allDone;
+    auto finished = allDone.getFuture();
+    std::mutex doneMutex;
+    auto complete = [&] {
+      if (executed.fetch_add(1) + 1 == outer * (inner + 1)) {
+        std::lock_guard lock(doneMutex);
+        allDone.setValue();
+      }
+    };
+    for (int i = 0; i < outer; ++i) {
+      executor->execute([&] {
+        // Submitted from a worker, others must steal them
+        for (int j = 0; j < inner; ++j) {
+          executor->execute(complete);
+        }
+        complete();
+      });
+    }
+    REQUIRE(finished.waitFor(std::chrono::seconds{10}) ==
+            std::future_status::ready);
+    REQUIRE(executed == outer * (inner + 1));
+  }
+
+  SECTION("runnables_are_done_after_shutdown") {
+    struct Counted : Runnable {
+      std::atomic_int *deleted;
+      explicit Counted(std::atomic_int *d) : deleted{d} {
+        setAutoDeleted(true);
+      }
+      ~Counted() override { ++*deleted; }
+      void run() override {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+      }
+    };
+    std::atomic_int deleted = 0;
+    for (int i = 0; i < 100; ++i) {
+      pool->run(new Counted{&deleted});
+    }
+    pool->shutdown();
+    REQUIRE(deleted == 100);
+    REQUIRE(!executor->execute([] {}));
+  }
+}
+
+TEST_CASE("ThreadPool_stops_running_tasks") {
+  using namespace maf::threading;
+  struct Spinning : Runnable {
+    std::atomic_bool stopped = false;
+    std::atomic_int *started;
+    explicit Spinning(std::atomic_int *s) : started{s} {
+      setAutoDeleted(false);
+    }
+    void run() override {
+      ++*started;
+      while (!stopped) {
+        std::this_thread::yield();
+      }
+    }
+    void stop() override { stopped = true; }
+  };
+
+  auto type = GENERATE(StableCount, DynamicCount, Priority, WorkStealing);
+  auto pool = ThreadPoolFactory::createPool(type, 2);
+  std::atomic_int started = 0;
+  std::vector<std::unique_ptr<Spinning>> runners;
+  for (int i = 0; i < 2; ++i) {
+    runners.push_back(std::make_unique<Spinning>(&started));
+    pool->run(runners.back().get());
+  }
+  while (started < 2) {
+    std::this_thread::yield();
+  }
+  pool->shutdown();
+  REQUIRE(std::all_of(runners.begin(), runners.end(),
+                      [](auto& r) { return r->stopped.load(); }));
+}
+
+TEST_CASE("ThreadPool_grows_while_shutting_down") {
+  using namespace maf::threading;
+  struct Idle : Runnable {
+    Idle() { setAutoDeleted(false); }
+    void run() override {}
+  };
+
+  constexpr unsigned int MaxThreads = 8;
+  constexpr int Callers = 4;
+  constexpr int RunsPerCaller = 50;
+  std::vector<Idle> runners(Callers * RunsPerCaller);
+  ThreadPoolImplBase<Queue<Runnable *>> pool{MaxThreads, &threading::run,
+                                             &threading::stop,
+                                             &threading::done};
+  std::vector<std::thread> callers;
+  for (int i = 0; i < Callers; ++i) {
+    callers.emplace_back([&pool, &runners, i] {
+      for (int j = 0; j < RunsPerCaller; ++j) {
+        pool.tryLaunchNewThread();
+        pool.run(&runners[i * RunsPerCaller + j]);
+      }
+    });
+  }
+  pool.shutdown();
+  for (auto& caller : callers) {
+    caller.join();
+  }
+  auto launched = pool.activeThreadCount();
+  REQUIRE(launched <= MaxThreads);
+  pool.tryLaunchNewThread();
+  REQUIRE(pool.activeThreadCount() == launched);
+}
+
+TEST_CASE("ElasticThreadPool_test") {
+  using namespace maf::threading;
+  struct Blocking : Runnable {
+    Future<void> released;
+    std::atomic_int* started;
+    Blocking(Future<void> r, std::atomic_int* s)
+        : released{std::move(r)}, started{s} {
+      setAutoDeleted(true);
+    }
+    void run() override {
+      ++*started;
+      released.wait();
+    }
+  };
+  auto waitUntil = [](auto condition) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (!condition() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+    return condition();
+  };
+
+  SECTION("grows_under_load_then_retires_idle_threads") {
+    auto pool = ThreadPoolFactory::createElasticPool(
+        {1, 4, std::chrono::milliseconds{0}, std::chrono::milliseconds{20}});
+    REQUIRE(pool->minThreadCount() == 1);
+    REQUIRE(pool->maxThreadCount() == 4);
+    REQUIRE(pool->activeThreadCount() == 1);
+    std::atomic_int started = 0;
+    std::vector<Promise<void>> releases(6);
+    for (auto& release : releases) {
+      pool->run(new Blocking{release.getFuture(), &started});
+    }
+    REQUIRE(waitUntil([&] { return started == 4; }));
+    REQUIRE(pool->activeThreadCount() == 4);
+    for (auto& release : releases) {
+      release.setValue();
+    }
+    REQUIRE(waitUntil([&] { return started == 6; }));
+    REQUIRE(waitUntil([&] { return pool->activeThreadCount() == 1; }));
+  }
+
+  SECTION("waits_for_spawn_latency") {
+    auto pool = ThreadPoolFactory::createElasticPool(
+        {1, 4, std::chrono::seconds{60}, std::chrono::seconds{60}});
+    std::atomic_int started = 0;
+    Promise<void> release;
+    pool->run(new Blocking{release.getFuture(), &started});
+    // Broken when it goes out of scope, before the pool is shut down
+    Promise<void> never;
+    pool->run(new Blocking{never.getFuture(), &started});
+    REQUIRE(waitUntil([&] { return started == 1; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    REQUIRE(started == 1);
+    REQUIRE(pool->activeThreadCount() == 1);
+    release.setValue();
+    REQUIRE(waitUntil([&] { return started == 2; }));
+  }
+
+  SECTION("spawns_once_queued_task_is_late") {
+    auto pool = ThreadPoolFactory::createElasticPool(
+        {1, 2, std::chrono::milliseconds{20}, std::chrono::seconds{60}});
+    std::atomic_int started = 0;
+    Promise<void> first;
+    Promise<void> second;
+    pool->run(new Blocking{first.getFuture(), &started});
+    pool->run(new Blocking{second.getFuture(), &started});
+    // Nothing else is queued or taken, the late task gets a thread anyway
+    REQUIRE(waitUntil([&] { return started == 2; }));
+    REQUIRE(pool->activeThreadCount() == 2);
+    first.setValue();
+    second.setValue();
+  }
+}
+
+TEST_CASE("ExecutorPool_test") {
+  using namespace maf::threading;
+  auto pool = ThreadPoolFactory::createExecutorPool(4);
+  REQUIRE(pool->threadCount() == 4);
+
+  SECTION("submit_move_only_callable") {
+    auto value = std::make_unique<int>(21);
+    auto doubled =
+        pool->submit([value = std::move(value)] { return *value * 2; });
+    REQUIRE(*doubled.get() == 42);
+  }
+
+  SECTION("submit_bulk") {
+    std::vector<std::function<int()>> callables;
+    for (int i = 0; i < 100; ++i) {
+      callables.push_back([i] { return i; });
+    }
+    auto futures = pool->submitBulk(std::move(callables));
+    REQUIRE(futures.size() == 100);
+    auto all = whenAll(std::move(futures)).get();
+    REQUIRE(all);
+    for (int i = 0; i < 100; ++i) {
+      REQUIRE(*(*all)[i].get() == i);
+    }
+  }
+
+  SECTION("submit_throwing_callable") {
+    auto failed = pool->submit([]() -> int {
+      throw std::runtime_error{"failed"};
+    });
+    REQUIRE_THROWS_AS(failed.get(), std::runtime_error);
+  }
+
+  SECTION("as_executor") {
+    auto executor = executorOf(pool);
+    Promise<std::thread::id> promise;
+    auto ranOn = promise.getFuture();
+    auto p = std::make_shared<Promise<std::thread::id>>(std::move(promise));
+    REQUIRE(executor->execute(
+        [p] { p->setValue(std::this_thread::get_id()); }));
+    REQUIRE(*ranOn.get() != std::this_thread::get_id());
+  }
+
+  SECTION("submit_racing_shutdown") {
+    std::vector<std::vector<Future<void>>> futures(3);
+    std::vector<std::thread> submitters;
+    for (auto &submitted : futures) {
+      submitters.emplace_back([&pool, &submitted] {
+        for (int i = 0; i < 2000; ++i) {
+          submitted.push_back(pool->submit([] {}));
+        }
+      });
+    }
+    pool->shutdown();
+    for (auto &submitter : submitters) {
+      submitter.join();
+    }
+    // Each one either ran or was dropped, none is left pending
+    for (auto &submitted : futures) {
+      for (auto &future : submitted) {
+        REQUIRE(future.ready());
+      }
+    }
+  }
+
+  SECTION("dropped_after_shutdown") {
+    auto executor = executorOf(pool);
+    pool->shutdown();
+    REQUIRE(!executor->execute([] {}));
+    REQUIRE_THROWS_AS(pool->submit([] {}).get(), std::future_error);
+    auto futures = pool->submitBulk(
+        std::vector<std::function<int()>>(2, [] { return 0; }));
+    REQUIRE(!futures[0].get());
+  }
+}
+
 }  // namespace maf